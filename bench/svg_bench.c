@@ -0,0 +1,85 @@
+// Benchmark of svg number formatting and writing. (make bench)
+// Formats coordinates the way appendnumbertosvg did before svg_format_int (snprintf "%d" into a stack buffer)
+// and with svg_format_int, then measures the whole writer streaming node rectangles to a stream that only counts.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "svg.h"
+
+#define NUMBERS 20000000
+#define RECTANGLES 2000000
+
+// Helper to return seconds on a monotonic clock.
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Stream write function that drops the bytes, counting them.
+static ssize_t count_bytes(void* cookie, const char* data, size_t size) {
+  (void)data;
+  *(size_t*)cookie += size;
+  return size;
+}
+
+// Helper to print a result line.
+static void report(const char* name, size_t bytes, double seconds, long count) {
+  printf("  %-28s %8.1f MB/s  %7.1f ns each\n", name, bytes / seconds / 1e6, seconds * 1e9 / count);
+}
+
+int main(void) {
+  // Coordinates like a large drawing's: mostly 3 to 5 digits, some negative.
+  int* numbers = malloc(sizeof(int) * NUMBERS);
+  if (numbers == NULL) {
+    fprintf(stderr, "Memory allocation failed.\n");
+    return 1;
+  }
+  srand(1);
+  for (int i = 0; i < NUMBERS; i++) {
+    numbers[i] = rand() % 40000 - (i % 16 == 0 ? 20000 : 0);
+  }
+
+  char buffer[SVG_NUMBER_MAX];
+  size_t bytes = 0;
+  unsigned checksum = 0; // Keeps the compiler from dropping the work.
+  printf("svg number formatting (%d numbers):\n", NUMBERS);
+  double start = now();
+  for (int i = 0; i < NUMBERS; i++) {
+    int length = snprintf(buffer, sizeof(buffer), "%d", numbers[i]);
+    bytes += length;
+    checksum += buffer[length - 1];
+  }
+  report("snprintf (before)", bytes, now() - start, NUMBERS);
+
+  bytes = 0;
+  start = now();
+  for (int i = 0; i < NUMBERS; i++) {
+    int length = svg_format_int(buffer, numbers[i]);
+    bytes += length;
+    checksum += buffer[length - 1];
+  }
+  report("svg_format_int", bytes, now() - start, NUMBERS);
+
+  size_t written = 0;
+  FILE* out = fopencookie(&written, "wb", (cookie_io_functions_t){ .write = count_bytes });
+  svg_t* svg = out != NULL ? svg_create_stream(40000, 40000, out) : NULL;
+  if (svg == NULL) {
+    fprintf(stderr, "Could not open output stream.\n");
+    return 1;
+  }
+  printf("svg writer (%d node rectangles):\n", RECTANGLES);
+  start = now();
+  for (int i = 0; i < RECTANGLES; i++) {
+    svg_rectangle_class(svg, "node", 200, 100, numbers[i] + 20000, numbers[i + 1] + 20000, 8, 8);
+  }
+  svg_save(svg);
+  report("svg_rectangle_class", written, now() - start, RECTANGLES);
+
+  svg_free(svg);
+  fclose(out);
+  free(numbers);
+  return checksum == 0;
+}
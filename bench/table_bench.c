@@ -0,0 +1,103 @@
+// Benchmark of table_t, the Swiss table, against the linear probing table it replaced. (make bench)
+// Inserts KEYS "node_N" keys (like node names), looks each of them up, looks up as many keys that aren't there,
+// then measures what only the Swiss table has: deleting half the keys and inserting into a reserved table.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "table.h"
+#include "table_old.h"
+
+#define KEYS 1000000
+#define KEY_MAX 16
+
+// Helper to return seconds on a monotonic clock.
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Helper to print a result line.
+static void report(const char* name, double seconds, long count) {
+  printf("  %-28s %8.3f s  %7.1f ns each\n", name, seconds, seconds * 1e9 / count);
+}
+
+int main(void) {
+  // Keys live in one block, tables don't copy them.
+  char* keys = malloc((size_t)KEYS * KEY_MAX);
+  char* missing = malloc((size_t)KEYS * KEY_MAX);
+  if (keys == NULL || missing == NULL) {
+    fprintf(stderr, "Memory allocation failed.\n");
+    return 1;
+  }
+  for (int i = 0; i < KEYS; i++) {
+    snprintf(keys + (size_t)i * KEY_MAX, KEY_MAX, "node_%d", i);
+    snprintf(missing + (size_t)i * KEY_MAX, KEY_MAX, "node_%d", KEYS + i);
+  }
+
+  long found = 0; // Keeps the compiler from dropping the lookups.
+  printf("linear probing table (%d keys):\n", KEYS);
+  old_table_t* old = old_create_table();
+  if (old == NULL) {
+    fprintf(stderr, "Memory allocation failed.\n");
+    return 1;
+  }
+  double start = now();
+  for (int i = 0; i < KEYS; i++) {
+    old_table_set(old, keys + (size_t)i * KEY_MAX, &found);
+  }
+  report("insert", now() - start, KEYS);
+  start = now();
+  for (int i = 0; i < KEYS; i++) {
+    found += old_table_get(old, keys + (size_t)i * KEY_MAX) != NULL;
+  }
+  report("hit", now() - start, KEYS);
+  start = now();
+  for (int i = 0; i < KEYS; i++) {
+    found += old_table_get(old, missing + (size_t)i * KEY_MAX) != NULL;
+  }
+  report("miss", now() - start, KEYS);
+  old_free_table(old);
+
+  printf("swiss table (%d keys):\n", KEYS);
+  table_t* table = create_table();
+  table_t* reserved = create_table();
+  if (table == NULL || reserved == NULL || !table_reserve(reserved, KEYS)) {
+    fprintf(stderr, "Memory allocation failed.\n");
+    return 1;
+  }
+  start = now();
+  for (int i = 0; i < KEYS; i++) {
+    table_set(table, keys + (size_t)i * KEY_MAX, &found);
+  }
+  report("insert", now() - start, KEYS);
+  start = now();
+  for (int i = 0; i < KEYS; i++) {
+    found += table_get(table, keys + (size_t)i * KEY_MAX) != NULL;
+  }
+  report("hit", now() - start, KEYS);
+  start = now();
+  for (int i = 0; i < KEYS; i++) {
+    found += table_get(table, missing + (size_t)i * KEY_MAX) != NULL;
+  }
+  report("miss", now() - start, KEYS);
+  start = now();
+  for (int i = 0; i < KEYS; i += 2) {
+    found += table_delete(table, keys + (size_t)i * KEY_MAX);
+  }
+  report("delete half", now() - start, KEYS / 2);
+  start = now();
+  for (int i = 0; i < KEYS; i++) {
+    table_set(reserved, keys + (size_t)i * KEY_MAX, &found);
+  }
+  report("insert after table_reserve", now() - start, KEYS);
+  free_table(table);
+  free_table(reserved);
+
+  free(keys);
+  free(missing);
+  // Every key is found twice (once per table) and half are deleted.
+  return found != KEYS * 2 + KEYS / 2;
+}
@@ -0,0 +1,36 @@
+#ifndef TABLE_OLD_H
+#define TABLE_OLD_H
+
+// Linear probing table_t from before the Swiss table (src/table.c), kept for table_bench to compare against.
+// Same code with old_ prefixed names, so both can be linked into one program.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Table entry struct
+typedef struct {
+  const char* key; // Not copied, has to live as long as the table. (e.g. an interned string)
+  void* value;
+} old_entry_t;
+
+// Hashtable struct
+typedef struct {
+  int count;
+  int capacity;
+  old_entry_t* entries;
+} old_table_t;
+
+// Creates, initializes, and returns table.
+old_table_t* old_create_table(void);
+// Frees memory used by table.
+void old_free_table(old_table_t* table);
+// Returns value from key in table, NULL if no key found.
+void* old_table_get(old_table_t* table, const char* key);
+// Returns value from the first length chars of key, NULL if no key found.
+void* old_table_get_n(old_table_t* table, const char* key, size_t length);
+// Sets a key value pair in the table. key isn't copied.
+const char* old_table_set(old_table_t* table, const char* key, void* value);
+// Prints the table.
+void old_print_table(old_table_t* table);
+
+#endif
@@ -0,0 +1,92 @@
+#include "arena.h"
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Usual block size, bigger allocations get a block of their own.
+#define BLOCK_SIZE (64 * 1024)
+
+// Block of memory handed out front to back.
+typedef struct block {
+  struct block* next;
+  size_t size;
+  size_t used;
+  alignas(max_align_t) unsigned char data[];
+} block_t;
+
+struct arena {
+  block_t* blocks; // Newest first, allocations come from the first one.
+};
+
+arena_t* arena_create(void) {
+  arena_t* arena = malloc(sizeof(arena_t));
+  if (arena == NULL) {
+    return NULL;
+  }
+  arena->blocks = NULL;
+  return arena;
+}
+
+// Helper to add a block with room for at least size bytes.
+static block_t* add_block(arena_t* arena, size_t size) {
+  size_t block_size = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+  block_t* block = malloc(sizeof(block_t) + block_size);
+  if (block == NULL) {
+    return NULL;
+  }
+  block->size = block_size;
+  block->used = 0;
+
+  // A big allocation's block goes second, so the current block keeps filling up.
+  if (size > BLOCK_SIZE && arena->blocks != NULL) {
+    block->next = arena->blocks->next;
+    arena->blocks->next = block;
+  } else {
+    block->next = arena->blocks;
+    arena->blocks = block;
+  }
+  return block;
+}
+
+// Helper to take size bytes starting at a multiple of alignment (a power of two, at most max_align_t's).
+static void* bump(arena_t* arena, size_t size, size_t alignment) {
+  block_t* block = arena->blocks;
+  size_t start = block != NULL ? (block->used + alignment - 1) & ~(alignment - 1) : 0;
+  if (block == NULL || start > block->size || block->size - start < size) {
+    block = add_block(arena, size);
+    if (block == NULL) {
+      return NULL;
+    }
+    start = block->used;
+  }
+  block->used = start + size;
+  return block->data + start;
+}
+
+void* arena_alloc(arena_t* arena, size_t size) {
+  return bump(arena, size, alignof(max_align_t));
+}
+
+char* arena_strndup(arena_t* arena, const char* text, size_t length) {
+  char* copy = bump(arena, length + 1, 1); // Strings don't need aligning.
+  if (copy == NULL) {
+    return NULL;
+  }
+  memcpy(copy, text, length);
+  copy[length] = '\0';
+  return copy;
+}
+
+void arena_free(arena_t* arena) {
+  if (arena == NULL) {
+    return;
+  }
+
+  block_t* block = arena->blocks;
+  while (block != NULL) {
+    block_t* next = block->next;
+    free(block);
+    block = next;
+  }
+  free(arena);
+}
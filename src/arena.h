@@ -0,0 +1,18 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator: allocations are carved out of big blocks and all freed together. (opaque, see arena.c)
+typedef struct arena arena_t;
+
+// Creates empty arena. Returns NULL if memory allocation failed.
+arena_t* arena_create(void);
+// Returns size bytes (aligned for any type) that live until the arena is freed, NULL if memory allocation failed.
+void* arena_alloc(arena_t* arena, size_t size);
+// Copies the first length chars of text into the arena, null terminated. Returns NULL if memory allocation failed.
+char* arena_strndup(arena_t* arena, const char* text, size_t length);
+// Frees every allocation and the arena itself. (arena can be NULL)
+void arena_free(arena_t* arena);
+
+#endif
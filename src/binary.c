@@ -0,0 +1,340 @@
+#include "binary.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "table.h"
+
+#define BINARY_MAGIC "LOGOSBIN"
+// Written as is, so files from a machine with the other byte order read differently and are refused.
+#define BINARY_BYTE_ORDER 0x01020304
+
+// Header at the start of the file. Offsets are from the start of the file.
+typedef struct {
+  char magic[8];       // BINARY_MAGIC, without a terminator.
+  uint32_t version;    // GRAPH_BINARY_VERSION.
+  uint32_t byte_order; // BINARY_BYTE_ORDER.
+  int32_t num_nodes;
+  int32_t num_edges;
+  int32_t num_bends;
+  int32_t width;
+  int32_t height;
+  int32_t unused;      // Keeps the offsets 8 byte aligned, always 0.
+  uint64_t title;      // Offset of the title string.
+  uint64_t names;
+  uint64_t texts;
+  uint64_t x;
+  uint64_t y;
+  uint64_t edge_offsets;
+  uint64_t edge_targets;
+  uint64_t edge_bend_offsets; // 0 when there are no bends.
+  uint64_t edge_bends;        // 0 when there are no bends.
+  uint64_t strings;
+  uint64_t length;     // Size of the whole file.
+} binary_header_t;
+
+// Names and texts are stored as offsets and become pointers in place when loaded.
+_Static_assert(sizeof(const char*) == sizeof(uint64_t), "binary graphs need 64 bit pointers");
+_Static_assert(sizeof(binary_header_t) % 8 == 0, "sections after the header have to stay aligned");
+
+// Helper to round offset up to the next multiple of 8.
+static uint64_t align_section(uint64_t offset) {
+  return (offset + 7) & ~(uint64_t)7;
+}
+
+bool is_graph_binary(const char* path) {
+  FILE* fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return false;
+  }
+  char magic[8];
+  bool binary = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, BINARY_MAGIC, 8) == 0;
+  fclose(fp);
+  return binary;
+}
+
+// Strings of a graph being written, each distinct one once, in the order they are written.
+typedef struct {
+  table_t* offsets;     // String -> its offset in the file.
+  const char** strings;
+  int count;
+  uint64_t start;       // Offset of the strings section.
+  uint64_t length;      // Bytes of strings so far, terminators included.
+} string_pool_t;
+
+// Helper to get the offset string will be written at, adding it to pool the first time. Returns 0 if memory
+// allocation failed. (the strings section always comes after the header, so no string is at 0)
+static uint64_t pool_string(string_pool_t* pool, const char* string) {
+  uint64_t offset = (uint64_t)(uintptr_t)table_get(pool->offsets, string);
+  if (offset != 0) {
+    return offset;
+  }
+  offset = pool->start + pool->length;
+  if (table_set(pool->offsets, string, (void*)(uintptr_t)offset) == NULL) {
+    return 0;
+  }
+  pool->strings[pool->count++] = string;
+  pool->length += strlen(string) + 1;
+  return offset;
+}
+
+// Helper to write size bytes of data at offset in fp, padding with zeros from written (bytes so far) up to it.
+static bool write_section(FILE* fp, uint64_t* written, uint64_t offset, const void* data, size_t size) {
+  static const char zeros[8] = { 0 };
+  if (offset - *written > sizeof(zeros) || fwrite(zeros, 1, offset - *written, fp) != offset - *written) {
+    return false;
+  }
+  *written = offset + size;
+  return size == 0 || fwrite(data, 1, size, fp) == size;
+}
+
+bool write_graph_binary(graph_t* g, const char* path) {
+  if (g->mapping == NULL && (g->edge_offsets == NULL || g->width == 0)) {
+    fprintf(g->errors, "Graph has to be laid out before it is written.\n");
+    return false;
+  }
+
+  // Lay the sections out.
+  int n = g->num_nodes;
+  int num_bends = g->edge_bend_offsets != NULL ? g->edge_bend_offsets[g->num_edges] : 0;
+  binary_header_t header = {
+    .version = GRAPH_BINARY_VERSION,
+    .byte_order = BINARY_BYTE_ORDER,
+    .num_nodes = n,
+    .num_edges = g->num_edges,
+    .num_bends = num_bends,
+    .width = g->width,
+    .height = g->height,
+  };
+  memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+  header.names = align_section(sizeof(binary_header_t));
+  header.texts = header.names + sizeof(uint64_t) * n;
+  header.x = header.texts + sizeof(uint64_t) * n;
+  header.y = header.x + sizeof(double) * n;
+  header.edge_offsets = header.y + sizeof(double) * n;
+  header.edge_targets = align_section(header.edge_offsets + sizeof(int32_t) * (n + 1));
+  uint64_t end = align_section(header.edge_targets + sizeof(int32_t) * g->num_edges);
+  if (num_bends > 0) {
+    header.edge_bend_offsets = end;
+    header.edge_bends = align_section(header.edge_bend_offsets + sizeof(int32_t) * (g->num_edges + 1));
+    end = header.edge_bends + sizeof(point_t) * num_bends;
+  }
+  header.strings = end;
+
+  // Gather the strings.
+  string_pool_t pool = { .offsets = create_table(), .strings = malloc(sizeof(const char*) * (2 * n + 1)),
+                         .start = header.strings };
+  uint64_t* names = malloc(sizeof(uint64_t) * (n > 0 ? n : 1));
+  uint64_t* texts = malloc(sizeof(uint64_t) * (n > 0 ? n : 1));
+  bool gathered = pool.offsets != NULL && pool.strings != NULL && names != NULL && texts != NULL &&
+                  (header.title = pool_string(&pool, g->title)) != 0;
+  for (int i = 0; gathered && i < n; i++) {
+    names[i] = pool_string(&pool, g->names[i]);
+    texts[i] = pool_string(&pool, g->texts[i]);
+    gathered = names[i] != 0 && texts[i] != 0;
+  }
+  header.length = header.strings + pool.length;
+
+  bool written = false;
+  if (!gathered) {
+    fprintf(g->errors, "Memory allocation failed for binary graph.\n");
+  } else {
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) {
+      fprintf(g->errors, "Could not open output file \"%s\".\n", path);
+    } else {
+      uint64_t offset = 0;
+      written = write_section(fp, &offset, 0, &header, sizeof(header)) &&
+                write_section(fp, &offset, header.names, names, sizeof(uint64_t) * n) &&
+                write_section(fp, &offset, header.texts, texts, sizeof(uint64_t) * n) &&
+                write_section(fp, &offset, header.x, g->x, sizeof(double) * n) &&
+                write_section(fp, &offset, header.y, g->y, sizeof(double) * n) &&
+                write_section(fp, &offset, header.edge_offsets, g->edge_offsets, sizeof(int32_t) * (n + 1)) &&
+                write_section(fp, &offset, header.edge_targets, g->edge_targets, sizeof(int32_t) * g->num_edges);
+      if (written && num_bends > 0) {
+        written = write_section(fp, &offset, header.edge_bend_offsets, g->edge_bend_offsets,
+                                sizeof(int32_t) * (g->num_edges + 1)) &&
+                  write_section(fp, &offset, header.edge_bends, g->edge_bends, sizeof(point_t) * num_bends);
+      }
+      uint64_t string = header.strings;
+      for (int i = 0; written && i < pool.count; i++) {
+        size_t length = strlen(pool.strings[i]) + 1;
+        written = write_section(fp, &offset, string, pool.strings[i], length);
+        string += length;
+      }
+      if (fclose(fp) != 0 || !written) {
+        fprintf(g->errors, "Could not write output file \"%s\".\n", path);
+        written = false;
+      }
+    }
+  }
+
+  if (pool.offsets != NULL) {
+    free_table(pool.offsets);
+  }
+  free(pool.strings);
+  free(names);
+  free(texts);
+  return written;
+}
+
+// Helper to check that count items of size fit in the file at offset, aligned and after the previous section
+// (which ends at end). Moves end past this one, so sections come in the documented order and never overlap.
+static bool next_section(const binary_header_t* header, uint64_t* end, uint64_t offset, uint64_t count,
+                         uint64_t size) {
+  if (offset % 8 != 0 || offset < *end || offset > header->length || count * size > header->length - offset) {
+    return false;
+  }
+  *end = offset + count * size;
+  return true;
+}
+
+// Helper to check that offset is in the strings section. (the file ends in a '\0', so the string ends in it too)
+static bool valid_string(const binary_header_t* header, uint64_t offset) {
+  return offset >= header->strings && offset < header->length;
+}
+
+// Helper to check that offsets (count + 1 of them) start at 0, never go down and end at last,
+// so ranges taken from them stay inside an array of last items.
+static bool valid_offsets(const int32_t* offsets, int count, int last) {
+  if (offsets[0] != 0 || offsets[count] != last) {
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    if (offsets[i + 1] < offsets[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Helper to check everything drawing indexes with, so a corrupt file is refused instead of read out of bounds.
+static bool valid_binary(const binary_header_t* header, const char* base, uint64_t size) {
+  if (header->length != size || header->num_nodes < 0 || header->num_edges < 0 || header->num_bends < 0 ||
+      header->width <= 0 || header->height <= 0) {
+    return false;
+  }
+  uint64_t n = header->num_nodes;
+  uint64_t e = header->num_edges;
+  bool bends = header->num_bends > 0;
+  // Names and texts are rewritten in place when loading, so above all they can't share bytes with anything.
+  uint64_t end = sizeof(binary_header_t);
+  if (!next_section(header, &end, header->names, n, sizeof(uint64_t)) ||
+      !next_section(header, &end, header->texts, n, sizeof(uint64_t)) ||
+      !next_section(header, &end, header->x, n, sizeof(double)) ||
+      !next_section(header, &end, header->y, n, sizeof(double)) ||
+      !next_section(header, &end, header->edge_offsets, n + 1, sizeof(int32_t)) ||
+      !next_section(header, &end, header->edge_targets, e, sizeof(int32_t)) ||
+      (bends && !next_section(header, &end, header->edge_bend_offsets, e + 1, sizeof(int32_t))) ||
+      (bends && !next_section(header, &end, header->edge_bends, header->num_bends, sizeof(point_t))) ||
+      header->strings < end || header->strings > header->length || base[header->length - 1] != '\0') {
+    return false;
+  }
+
+  const uint64_t* names = (const uint64_t*)(base + header->names);
+  const uint64_t* texts = (const uint64_t*)(base + header->texts);
+  if (!valid_string(header, header->title)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    if (!valid_string(header, names[i]) || !valid_string(header, texts[i])) {
+      return false;
+    }
+  }
+
+  const int32_t* targets = (const int32_t*)(base + header->edge_targets);
+  if (!valid_offsets((const int32_t*)(base + header->edge_offsets), header->num_nodes, header->num_edges) ||
+      (bends && !valid_offsets((const int32_t*)(base + header->edge_bend_offsets), header->num_edges,
+                               header->num_bends))) {
+    return false;
+  }
+  for (uint64_t i = 0; i < e; i++) {
+    if (targets[i] < 0 || targets[i] >= header->num_nodes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Helper to turn count string offsets in place into pointers into the mapping at base.
+static const char** relocate_strings(char* base, uint64_t offset, int count) {
+  char* slots = base + offset;
+  for (int i = 0; i < count; i++) {
+    uint64_t string;
+    memcpy(&string, slots + i * sizeof(uint64_t), sizeof(string));
+    const char* pointer = base + string;
+    memcpy(slots + i * sizeof(uint64_t), &pointer, sizeof(pointer));
+  }
+  return (const char**)slots;
+}
+
+graph_t* read_graph_binary(const char* path, FILE* errors) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    fprintf(errors, "Could not open file \"%s\".\n", path);
+    return NULL;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(binary_header_t)) {
+    fprintf(errors, "\"%s\" is not a logos binary graph.\n", path);
+    close(fd);
+    return NULL;
+  }
+  size_t size = (size_t)info.st_size;
+  // Private, so turning offsets into pointers never writes to the file.
+  char* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    fprintf(errors, "Could not read file \"%s\".\n", path);
+    return NULL;
+  }
+
+  const binary_header_t* header = (const binary_header_t*)base;
+  if (memcmp(header->magic, BINARY_MAGIC, sizeof(header->magic)) != 0 || header->byte_order != BINARY_BYTE_ORDER) {
+    fprintf(errors, "\"%s\" is not a logos binary graph.\n", path);
+    munmap(base, size);
+    return NULL;
+  }
+  if (header->version != GRAPH_BINARY_VERSION) {
+    fprintf(errors, "\"%s\" is binary graph version %u, expected %d.\n", path, header->version,
+            GRAPH_BINARY_VERSION);
+    munmap(base, size);
+    return NULL;
+  }
+  graph_t* g = calloc(1, sizeof(graph_t));
+  if (g == NULL || !valid_binary(header, base, size)) {
+    fprintf(errors, g == NULL ? "Memory allocation failed for graph.\n" : "\"%s\" is a corrupt binary graph.\n", path);
+    free(g);
+    munmap(base, size);
+    return NULL;
+  }
+
+  g->title = base + header->title;
+  g->names = relocate_strings(base, header->names, header->num_nodes);
+  g->texts = relocate_strings(base, header->texts, header->num_nodes);
+  g->x = (double*)(base + header->x);
+  g->y = (double*)(base + header->y);
+  g->edge_offsets = (int*)(base + header->edge_offsets);
+  g->edge_targets = (int*)(base + header->edge_targets);
+  if (header->num_bends > 0) {
+    g->edge_bend_offsets = (int*)(base + header->edge_bend_offsets);
+    g->edge_bends = (point_t*)(base + header->edge_bends);
+  }
+  g->num_nodes = header->num_nodes;
+  g->num_edges = header->num_edges;
+  g->capacity = header->num_nodes;
+  g->width = header->width;
+  g->height = header->height;
+  g->errors = errors;
+  g->mapping = base;
+  g->mapping_length = size;
+  return g;
+}
+
+void free_graph_binary(graph_t* g) {
+  munmap(g->mapping, g->mapping_length);
+  free(g);
+}
@@ -0,0 +1,34 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "graph.h"
+
+// Binary graph format: a laid out graph exactly as it gets drawn, so drawing it again skips parsing and layout.
+// The file is the header (see binary.c) followed by these sections in this order, each starting 8 byte aligned at
+// the offset the header gives and never overlapping the one before, in the byte order of the machine that wrote it:
+//   names, texts       num_nodes uint64 offsets of null terminated strings in the file.
+//   x, y               num_nodes doubles, positions in the drawing.
+//   edge_offsets       num_nodes + 1 int32, node i's targets are edge_targets[edge_offsets[i]] up to [i + 1].
+//   edge_targets       num_edges int32.
+//   edge_bend_offsets  num_edges + 1 int32, only when num_bends > 0. (same as the graph's)
+//   edge_bends         num_bends point_t.
+//   strings            The title, names and texts, each distinct string once.
+
+// Version written, files with any other version are refused.
+#define GRAPH_BINARY_VERSION 1
+
+// Returns if the file at path starts like a binary graph.
+bool is_graph_binary(const char* path);
+// Writes laid out graph to path. Returns false (after printing why to the graph's errors) if it couldn't.
+bool write_graph_binary(graph_t* g, const char* path);
+// Loads the binary graph at path with a single mmap, the graph's arrays point straight into the mapping.
+// Only the string offsets are turned into pointers in place. (in a private copy-on-write mapping)
+// The graph is already laid out and can only be drawn. Returns NULL (after printing why to errors) if the file
+// couldn't be read or isn't a valid binary graph.
+graph_t* read_graph_binary(const char* path, FILE* errors);
+// Unmaps a graph loaded by read_graph_binary. (free_graph calls it)
+void free_graph_binary(graph_t* g);
+
+#endif
@@ -0,0 +1,208 @@
+#include "cache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hash.h"
+
+// Bytes copied per read when an output can't be linked.
+#define COPY_CHUNK_SIZE (64 * 1024)
+
+// Helper to add string and its terminator to both halves of a key, so neighbouring strings can't run together.
+static void hash_string(hasher_t hashers[2], const char* string) {
+  for (int i = 0; i < 2; i++) {
+    hasher_update(&hashers[i], string, strlen(string) + 1);
+  }
+}
+
+// Helper to add number to both halves of a key.
+static void hash_number(hasher_t hashers[2], int64_t number) {
+  for (int i = 0; i < 2; i++) {
+    hasher_update(&hashers[i], &number, sizeof(number));
+  }
+}
+
+void cache_key(const char* source, size_t length, const draw_options_t* options, char* key) {
+  // Two differently seeded hashes make up the 128 bits.
+  hasher_t hashers[2];
+  hasher_init(&hashers[0], 0);
+  hasher_init(&hashers[1], 0x6c6f676f73ULL);
+
+  hash_number(hashers, CACHE_VERSION);
+  hash_number(hashers, (int64_t)length);
+  for (int i = 0; i < 2; i++) {
+    hasher_update(&hashers[i], source, length);
+  }
+  hash_string(hashers, options->bg_color);
+  hash_string(hashers, options->node_color);
+  hash_number(hashers, options->text_size);
+  hash_number(hashers, options->layout);
+  hash_number(hashers, options->format);
+  hash_number(hashers, options->compress_level);
+
+  snprintf(key, CACHE_KEY_LENGTH + 1, "%016" PRIx64 "%016" PRIx64, hasher_final(&hashers[0]),
+           hasher_final(&hashers[1]));
+}
+
+// Helper to return "<directory>/<name>", NULL if memory allocation failed. (the caller frees it)
+static char* join_path(const char* directory, const char* name) {
+  size_t length = strlen(directory) + 1 + strlen(name) + 1;
+  char* path = malloc(length);
+  if (path != NULL) {
+    snprintf(path, length, "%s/%s", directory, name);
+  }
+  return path;
+}
+
+// Helper to copy the file at from to to, replacing to. Returns false if it couldn't.
+static bool copy_file(const char* from, const char* to) {
+  int in = open(from, O_RDONLY);
+  if (in == -1) {
+    return false;
+  }
+  int out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  char* buffer = malloc(COPY_CHUNK_SIZE);
+  bool copied = out != -1 && buffer != NULL;
+  while (copied) {
+    ssize_t bytes_read = read(in, buffer, COPY_CHUNK_SIZE);
+    if (bytes_read == 0) {
+      break;
+    }
+    if (bytes_read < 0) {
+      copied = errno == EINTR;
+      continue;
+    }
+    for (ssize_t written = 0; copied && written < bytes_read;) {
+      ssize_t bytes_written = write(out, buffer + written, bytes_read - written);
+      if (bytes_written < 0) {
+        copied = errno == EINTR;
+      } else {
+        written += bytes_written;
+      }
+    }
+  }
+  free(buffer);
+  close(in);
+  if (out != -1 && close(out) != 0) {
+    copied = false;
+  }
+  return copied;
+}
+
+// Helper to make to the same file as from, as a hard link if possible, else as a copy. Replaces to.
+static bool link_or_copy(const char* from, const char* to) {
+  // Unlinked first, so an old output that is itself a link to an entry is never written through.
+  if (unlink(to) != 0 && errno != ENOENT) {
+    return false;
+  }
+  return link(from, to) == 0 || copy_file(from, to);
+}
+
+// Helper to read the first line of the (small) file at path. Returns NULL if it couldn't. (the caller frees it)
+static char* read_name(const char* path) {
+  FILE* fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return NULL;
+  }
+  struct stat info;
+  char* name = NULL;
+  if (fstat(fileno(fp), &info) == 0 && info.st_size > 0) {
+    name = malloc(info.st_size + 1);
+    if (name != NULL && fread(name, 1, info.st_size, fp) == (size_t)info.st_size) {
+      name[info.st_size] = '\0';
+      name[strcspn(name, "\n")] = '\0';
+    } else {
+      free(name);
+      name = NULL;
+    }
+  }
+  fclose(fp);
+  return name;
+}
+
+char* cache_lookup(const char* dir, const char* key) {
+  char* entry = join_path(dir, key);
+  char* name_path = entry != NULL ? join_path(entry, "name") : NULL;
+  char* output_path = entry != NULL ? join_path(entry, "output") : NULL;
+  char* name = name_path != NULL && output_path != NULL && access(output_path, F_OK) == 0 ? read_name(name_path)
+                                                                                          : NULL;
+  free(entry);
+  free(name_path);
+  free(output_path);
+  return name;
+}
+
+bool cache_fetch(const char* dir, const char* key, const char* name, FILE* errors) {
+  char* entry = join_path(dir, key);
+  char* output_path = entry != NULL ? join_path(entry, "output") : NULL;
+  bool fetched = output_path != NULL && link_or_copy(output_path, name);
+  if (fetched) {
+    // Outputs are newer than their sources, like when drawn, so build tools that compare times are happy.
+    utimensat(AT_FDCWD, name, NULL, 0);
+  } else {
+    fprintf(errors, "Could not copy cached output to \"%s\".\n", name);
+  }
+  free(entry);
+  free(output_path);
+  return fetched;
+}
+
+// Helper to remove a half built entry. (the files it may hold, then itself)
+static void remove_entry(const char* entry) {
+  const char* files[] = { "output", "name" };
+  for (int i = 0; i < 2; i++) {
+    char* path = join_path(entry, files[i]);
+    if (path != NULL) {
+      unlink(path);
+      free(path);
+    }
+  }
+  rmdir(entry);
+}
+
+bool cache_store(const char* dir, const char* key, const char* path, const char* name, FILE* errors) {
+  if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+    fprintf(errors, "Could not create cache directory \"%s\".\n", dir);
+    return false;
+  }
+
+  // Built under a unique temporary name, then renamed into place whole.
+  char* entry = join_path(dir, key);
+  char* temporary = join_path(dir, ".entry-XXXXXX");
+  if (entry == NULL || temporary == NULL || mkdtemp(temporary) == NULL) {
+    fprintf(errors, "Could not create cache entry in \"%s\".\n", dir);
+    free(entry);
+    free(temporary);
+    return false;
+  }
+
+  char* output_path = join_path(temporary, "output");
+  char* name_path = join_path(temporary, "name");
+  bool stored = output_path != NULL && name_path != NULL && link_or_copy(path, output_path);
+  if (stored) {
+    FILE* fp = fopen(name_path, "wb");
+    stored = fp != NULL && fprintf(fp, "%s\n", name) >= 0;
+    if (fp != NULL && fclose(fp) != 0) {
+      stored = false;
+    }
+  }
+  if (stored && rename(temporary, entry) != 0) {
+    // Stored by someone else in the meantime (renaming over a full directory fails), which is just as good.
+    stored = errno == EEXIST || errno == ENOTEMPTY;
+    remove_entry(temporary);
+  } else if (!stored) {
+    remove_entry(temporary);
+  }
+  if (!stored) {
+    fprintf(errors, "Could not store \"%s\" in cache directory \"%s\".\n", name, dir);
+  }
+
+  free(entry);
+  free(temporary);
+  free(output_path);
+  free(name_path);
+  return stored;
+}
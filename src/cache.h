@@ -0,0 +1,35 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "graph.h"
+
+// Output cache: every output drawn is stored in a directory under a hash of its source and of the options that
+// change it, so drawing an unchanged source again is a link (or copy) of the stored file instead.
+// The entry for a key is the directory <dir>/<key>, holding "output" (the drawn file) and "name" (the path it was
+// drawn to, relative to the working directory). That path comes from the title and the format options, which are
+// all part of the key, so a hit puts the output at the same path drawing it again would.
+
+// Hex digits in a key.
+#define CACHE_KEY_LENGTH 32
+// Part of every key. Bump it when a change to logos changes the output for the same source and options,
+// so entries from before aren't used anymore.
+#define CACHE_VERSION 1
+
+// Sets key (CACHE_KEY_LENGTH hex digits and a '\0') to the 128 bit hash of the first length bytes of source and
+// the options that change the output: colors, text size, layout, format and compression.
+void cache_key(const char* source, size_t length, const draw_options_t* options, char* key);
+// Returns the path the output stored under key was drawn to, NULL if there is no such entry. (the caller frees it)
+char* cache_lookup(const char* dir, const char* key);
+// Puts the output stored under key back at name (its path, from cache_lookup), as a hard link to the stored file
+// (a copy if that fails). Returns false (after printing why to errors) if it couldn't be put back.
+bool cache_fetch(const char* dir, const char* key, const char* name, FILE* errors);
+// Stores the output drawn to path under key, to be put back at name, creating dir if needed. path should be a file
+// only this caller writes (name is where it goes once stored), so the entry holds exactly what was drawn. Entries
+// are renamed into place whole, so processes and threads sharing dir never see half of one.
+// Returns false (after printing why) if it couldn't.
+bool cache_store(const char* dir, const char* key, const char* path, const char* name, FILE* errors);
+
+#endif
@@ -0,0 +1,315 @@
+#include "component.h"
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// One connected component while it is laid out and packed.
+typedef struct {
+  graph_t graph; // The component's nodes (in id order) and edges, with ids local to it. (only what layouts use)
+  bool laid_out;
+  double min_x;  // Extent of its nodes and bends once laid out.
+  double min_y;
+  double width;  // Box size, including the node size and gap.
+  double height;
+  double x;      // Where the box's top left is packed.
+  double y;
+} component_t;
+
+// Shared state of the component layout tasks.
+typedef struct {
+  component_t* components;
+  int* schedule; // Component indices, most nodes first, so big ones don't end up last on a thread.
+  component_layout layout;
+  void* context;
+} components_t;
+
+// Task laying out one component and measuring its extent.
+static void layout_component(void* context, int index) {
+  components_t* c = context;
+  component_t* component = &c->components[c->schedule[index]];
+  graph_t* g = &component->graph;
+
+  component->laid_out = c->layout(g, c->context);
+  if (!component->laid_out) {
+    return;
+  }
+
+  double min_x = g->x[0];
+  double min_y = g->y[0];
+  double max_x = min_x;
+  double max_y = min_y;
+  for (int i = 1; i < g->num_nodes; i++) {
+    min_x = fmin(min_x, g->x[i]);
+    min_y = fmin(min_y, g->y[i]);
+    max_x = fmax(max_x, g->x[i]);
+    max_y = fmax(max_y, g->y[i]);
+  }
+  int num_bends = g->edge_bend_offsets != NULL ? g->edge_bend_offsets[g->num_edges] : 0;
+  for (int b = 0; b < num_bends; b++) {
+    min_x = fmin(min_x, g->edge_bends[b].x);
+    min_y = fmin(min_y, g->edge_bends[b].y);
+    max_x = fmax(max_x, g->edge_bends[b].x);
+    max_y = fmax(max_y, g->edge_bends[b].y);
+  }
+  component->min_x = min_x;
+  component->min_y = min_y;
+  component->width = max_x - min_x;
+  component->height = max_y - min_y;
+}
+
+// Sort key of a component, for the layout schedule and the packing order.
+typedef struct {
+  double key;
+  int index;
+} ranked_t;
+
+// Helper to order ranked components by key, largest first. (ties by index, so the order is the same every run)
+static int compare_ranked(const void* a, const void* b) {
+  const ranked_t* x = a;
+  const ranked_t* y = b;
+  if (x->key != y->key) {
+    return x->key < y->key ? 1 : -1;
+  }
+  return x->index - y->index;
+}
+
+// Helper to fill order with component indices sorted by their box height (or node count), largest first.
+static void rank_components(component_t* components, int count, bool by_height, ranked_t* ranks, int* order) {
+  for (int i = 0; i < count; i++) {
+    ranks[i].key = by_height ? components[i].height : components[i].graph.num_nodes;
+    ranks[i].index = i;
+  }
+  qsort(ranks, count, sizeof(ranked_t), compare_ranked);
+  for (int i = 0; i < count; i++) {
+    order[i] = ranks[i].index;
+  }
+}
+
+// Shelf packing: boxes go left to right on the current shelf, and a new shelf starts below the tallest
+// box of the current one when the next box doesn't fit. Shelves are as wide as the widest box or the
+// square root of the total area, whichever is more.
+static void pack_shelves(component_t* components, int* order, int count) {
+  double area = 0.0;
+  double shelf_width = 0.0;
+  for (int i = 0; i < count; i++) {
+    area += components[i].width * components[i].height;
+    shelf_width = fmax(shelf_width, components[i].width);
+  }
+  shelf_width = fmax(shelf_width, sqrt(area));
+
+  double x = 0.0;
+  double y = 0.0;
+  double shelf_height = 0.0;
+  for (int i = 0; i < count; i++) {
+    component_t* component = &components[order[i]];
+    if (x > 0.0 && x + component->width > shelf_width) {
+      x = 0.0;
+      y += shelf_height;
+      shelf_height = 0.0;
+    }
+    component->x = x;
+    component->y = y;
+    x += component->width;
+    shelf_height = fmax(shelf_height, component->height);
+  }
+}
+
+// Helper to copy the components' bend points back into g, in g's edge order, moved along with their component.
+static bool gather_bends(graph_t* g, component_t* components, int num_components, const int* node_component) {
+  bool any_bends = false;
+  for (int c = 0; c < num_components; c++) {
+    any_bends |= components[c].graph.edge_bend_offsets != NULL;
+  }
+  free(g->edge_bend_offsets);
+  free(g->edge_bends);
+  g->edge_bend_offsets = NULL;
+  g->edge_bends = NULL;
+  if (!any_bends) {
+    return true;
+  }
+
+  // A component's edges are g's edges of its nodes in the same order, so a running count per component
+  // gives each edge's index in its component.
+  int* next_edge = calloc(num_components, sizeof(int));
+  g->edge_bend_offsets = malloc(sizeof(int) * (g->num_edges + 1));
+  if (next_edge == NULL || g->edge_bend_offsets == NULL) {
+    free(next_edge);
+    free(g->edge_bend_offsets);
+    g->edge_bend_offsets = NULL;
+    return false;
+  }
+  int num_bends = 0;
+  for (int u = 0; u < g->num_nodes; u++) {
+    graph_t* component = &components[node_component[u]].graph;
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      int local = next_edge[node_component[u]]++;
+      g->edge_bend_offsets[e] = num_bends;
+      if (component->edge_bend_offsets != NULL) {
+        num_bends += component->edge_bend_offsets[local + 1] - component->edge_bend_offsets[local];
+      }
+    }
+  }
+  g->edge_bend_offsets[g->num_edges] = num_bends;
+
+  g->edge_bends = malloc(sizeof(point_t) * (num_bends > 0 ? num_bends : 1));
+  if (g->edge_bends == NULL) {
+    free(next_edge);
+    free(g->edge_bend_offsets);
+    g->edge_bend_offsets = NULL;
+    return false;
+  }
+  memset(next_edge, 0, sizeof(int) * num_components);
+  for (int u = 0; u < g->num_nodes; u++) {
+    component_t* component = &components[node_component[u]];
+    int* offsets = component->graph.edge_bend_offsets;
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      int local = next_edge[node_component[u]]++;
+      if (offsets == NULL) {
+        continue;
+      }
+      for (int b = offsets[local]; b < offsets[local + 1]; b++) {
+        point_t* bend = &g->edge_bends[g->edge_bend_offsets[e] + b - offsets[local]];
+        bend->x = component->graph.edge_bends[b].x - component->min_x + component->x;
+        bend->y = component->graph.edge_bends[b].y - component->min_y + component->y;
+      }
+    }
+  }
+
+  free(next_edge);
+  return true;
+}
+
+bool layout_components(graph_t* g, component_layout layout, void* context,
+                       double node_width, double node_height, double gap, pool_t* pool) {
+  if (!freeze_edges(g)) {
+    return false;
+  }
+  // Nothing to split or pack.
+  if (g->num_components <= 1) {
+    return layout(g, context);
+  }
+
+  int n = g->num_nodes;
+  int num_components = g->num_components;
+  component_t* components = calloc(num_components, sizeof(component_t));
+  int* node_component = malloc(sizeof(int) * n);
+  int* local_id = malloc(sizeof(int) * n);
+  int* root_component = malloc(sizeof(int) * n);
+  double* x = malloc(sizeof(double) * n);
+  double* y = malloc(sizeof(double) * n);
+  int* levels = malloc(sizeof(int) * n);
+  int* parents = malloc(sizeof(int) * n);
+  int* edge_offsets = malloc(sizeof(int) * (n + num_components));
+  int* edge_targets = malloc(sizeof(int) * (g->num_edges > 0 ? g->num_edges : 1));
+  int* schedule = malloc(sizeof(int) * num_components);
+  ranked_t* ranks = malloc(sizeof(ranked_t) * num_components);
+  if (!components || !node_component || !local_id || !root_component || !x || !y || !levels || !parents ||
+      !edge_offsets || !edge_targets || !schedule || !ranks) {
+    fprintf(g->errors, "Memory allocation failed for component layout.\n");
+    free(components);
+    free(node_component);
+    free(local_id);
+    free(root_component);
+    free(x);
+    free(y);
+    free(levels);
+    free(parents);
+    free(edge_offsets);
+    free(edge_targets);
+    free(schedule);
+    free(ranks);
+    return false;
+  }
+
+  // Number components by their lowest node id, and count their nodes and edges.
+  for (int i = 0; i < n; i++) {
+    root_component[i] = -1;
+  }
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    int root = find_component(g, i);
+    if (root_component[root] == -1) {
+      root_component[root] = count++;
+    }
+    component_t* component = &components[root_component[root]];
+    node_component[i] = root_component[root];
+    local_id[i] = component->graph.num_nodes++;
+    component->graph.num_edges += g->edge_offsets[i + 1] - g->edge_offsets[i];
+  }
+
+  // Carve the shared arrays into each component's node attributes and CSR edges.
+  // (a component needs one more offset than nodes)
+  int node_start = 0;
+  int edge_start = 0;
+  for (int c = 0; c < num_components; c++) {
+    graph_t* component = &components[c].graph;
+    component->x = x + node_start;
+    component->y = y + node_start;
+    component->levels = levels + node_start;
+    component->parents = parents + node_start;
+    component->edge_offsets = edge_offsets + node_start + c;
+    component->edge_targets = edge_targets + edge_start;
+    component->edge_offsets[0] = 0;
+    component->capacity = component->num_nodes;
+    component->num_components = 1;
+    component->errors = g->errors;
+    node_start += component->num_nodes;
+    edge_start += component->num_edges;
+    component->num_nodes = 0;
+    component->num_edges = 0;
+  }
+  for (int u = 0; u < n; u++) {
+    graph_t* component = &components[node_component[u]].graph;
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      component->edge_targets[component->num_edges++] = local_id[g->edge_targets[e]];
+    }
+    component->levels[component->num_nodes] = g->levels[u];
+    component->parents[component->num_nodes] = g->parents[u] != -1 ? local_id[g->parents[u]] : -1;
+    component->num_nodes++;
+    component->edge_offsets[component->num_nodes] = component->num_edges;
+  }
+
+  rank_components(components, num_components, false, ranks, schedule);
+  components_t c = { .components = components, .schedule = schedule, .layout = layout, .context = context };
+  pool_run(pool, layout_component, &c, num_components);
+
+  bool laid_out = true;
+  for (int i = 0; i < num_components; i++) {
+    laid_out &= components[i].laid_out;
+    components[i].width += node_width + gap;
+    components[i].height += node_height + gap;
+  }
+
+  if (laid_out) {
+    rank_components(components, num_components, true, ranks, schedule);
+    pack_shelves(components, schedule, num_components);
+    for (int i = 0; i < n; i++) {
+      component_t* component = &components[node_component[i]];
+      g->x[i] = component->graph.x[local_id[i]] - component->min_x + component->x;
+      g->y[i] = component->graph.y[local_id[i]] - component->min_y + component->y;
+    }
+    if (!gather_bends(g, components, num_components, node_component)) {
+      fprintf(g->errors, "Memory allocation failed for component layout.\n");
+      laid_out = false;
+    }
+  }
+
+  for (int i = 0; i < num_components; i++) {
+    free(components[i].graph.edge_bend_offsets);
+    free(components[i].graph.edge_bends);
+  }
+  free(components);
+  free(node_component);
+  free(local_id);
+  free(root_component);
+  free(x);
+  free(y);
+  free(levels);
+  free(parents);
+  free(edge_offsets);
+  free(edge_targets);
+  free(schedule);
+  free(ranks);
+  return laid_out;
+}
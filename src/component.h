@@ -0,0 +1,20 @@
+#ifndef COMPONENT_H
+#define COMPONENT_H
+
+#include <stdbool.h>
+#include "graph.h"
+#include "pool.h"
+
+// Lays out one connected component, handed over as a graph of its own. Returns false on failure.
+typedef bool (*component_layout)(graph_t* component, void* context);
+
+// Lays out every connected component of g on its own with layout, spread over pool's threads (pool can be NULL),
+// then packs them onto shelves (rows, tallest components first) so the drawing stays roughly square.
+// Component graphs only get the node attributes layouts use (levels, parents) with ids local to them.
+// Every component's box is its nodes' (and bends') extent plus node_width by node_height, gap apart.
+// The packed drawing ends up with its top left node at (0, 0).
+// Returns false if memory allocation or one of the layouts failed.
+bool layout_components(graph_t* g, component_layout layout, void* context,
+                       double node_width, double node_height, double gap, pool_t* pool);
+
+#endif
@@ -0,0 +1,915 @@
+#include "deflate.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// DEFLATE (RFC 1951) encoder with zlib (RFC 1950) and gzip (RFC 1952) wrappers.
+// LZ77 matching uses hash chains over a sliding 32K window and each block is written
+// stored, with fixed codes, or with dynamic codes, whichever is smallest.
+
+#define WINDOW_SIZE 32768
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define MIN_LOOKAHEAD (MAX_MATCH + MIN_MATCH + 1)
+#define TOO_FAR 4096 // Length 3 matches further away than this cost more than literals.
+
+#define HASH_BITS 15
+#define HASH_SIZE (1 << HASH_BITS)
+
+#define MAX_SYMBOLS 16384
+#define OUT_BUFFER_SIZE 16384
+#define MAX_STORED 65535
+
+#define LITLEN_CODES 286
+#define FIXED_LITLEN_CODES 288
+#define DIST_CODES 30
+#define CODELEN_CODES 19
+#define END_OF_BLOCK 256
+#define MAX_BITS 15
+#define MAX_CODELEN_BITS 7
+
+// Match finder settings per level. (same tuning as zlib)
+typedef struct {
+  int good_length; // Search less of the chain once a match this long is found.
+  int max_lazy;    // Lazy: don't look for better matches past this length. Greedy: longest match to hash fully.
+  int nice_length; // Stop searching at this match length.
+  int max_chain;   // Max hash chain entries to look at.
+  bool lazy;       // Check if the next position has a better match before taking one.
+} level_config_t;
+
+static const level_config_t LEVELS[10] = {
+  {  0,   0,   0,    0, false }, // 0: store only
+  {  4,   4,   8,    4, false }, // 1: fastest
+  {  4,   5,  16,    8, false },
+  {  4,   6,  32,   32, false },
+  {  4,   4,  16,   16, true },
+  {  8,  16,  32,   32, true },
+  {  8,  16, 128,  128, true },  // 6: default
+  {  8,  32, 128,  256, true },
+  { 32, 128, 258, 1024, true },
+  { 32, 258, 258, 4096, true },  // 9: smallest
+};
+
+// Base value and extra bits of each length code (257-285) and distance code.
+static const uint16_t LENGTH_BASE[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LENGTH_EXTRA[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DIST_BASE[DIST_CODES] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DIST_EXTRA[DIST_CODES] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+// Order code length code lengths are written in.
+static const uint8_t CODELEN_ORDER[CODELEN_CODES] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// Length code index (0-28) of each match length 3-258.
+static const uint8_t LENGTH_CODE[256] = {
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  8,  9,  9, 10, 10, 11, 11,
+  12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15,
+  16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 17, 17, 17,
+  18, 18, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19, 19, 19,
+  20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22,
+  23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23,
+  24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24,
+  24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24,
+  25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25,
+  25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25,
+  26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26,
+  26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26,
+  27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27,
+  27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 28
+};
+// Distance code of distances 1-256 (by distance - 1), and of larger distances by (distance - 1) >> 7.
+static const uint8_t DIST_CODE_LOW[256] = {
+   0,  1,  2,  3,  4,  4,  5,  5,  6,  6,  6,  6,  7,  7,  7,  7,
+   8,  8,  8,  8,  8,  8,  8,  8,  9,  9,  9,  9,  9,  9,  9,  9,
+  10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+  11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11,
+  12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+  12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+  13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13,
+  13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13,
+  14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+  14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+  14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+  14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+  15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15
+};
+static const uint8_t DIST_CODE_HIGH[256] = {
+   0, 14, 16, 17, 18, 18, 19, 19, 20, 20, 20, 20, 21, 21, 21, 21,
+  22, 22, 22, 22, 22, 22, 22, 22, 23, 23, 23, 23, 23, 23, 23, 23,
+  24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24,
+  25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25,
+  26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26,
+  26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26,
+  27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27,
+  27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27,
+  28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+  28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+  28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+  28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+  29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29,
+  29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29,
+  29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29,
+  29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29
+};
+
+static const uint32_t CRC_TABLE[256] = {
+  0x00000000u, 0x77073096u, 0xee0e612cu, 0x990951bau, 0x076dc419u, 0x706af48fu,
+  0xe963a535u, 0x9e6495a3u, 0x0edb8832u, 0x79dcb8a4u, 0xe0d5e91eu, 0x97d2d988u,
+  0x09b64c2bu, 0x7eb17cbdu, 0xe7b82d07u, 0x90bf1d91u, 0x1db71064u, 0x6ab020f2u,
+  0xf3b97148u, 0x84be41deu, 0x1adad47du, 0x6ddde4ebu, 0xf4d4b551u, 0x83d385c7u,
+  0x136c9856u, 0x646ba8c0u, 0xfd62f97au, 0x8a65c9ecu, 0x14015c4fu, 0x63066cd9u,
+  0xfa0f3d63u, 0x8d080df5u, 0x3b6e20c8u, 0x4c69105eu, 0xd56041e4u, 0xa2677172u,
+  0x3c03e4d1u, 0x4b04d447u, 0xd20d85fdu, 0xa50ab56bu, 0x35b5a8fau, 0x42b2986cu,
+  0xdbbbc9d6u, 0xacbcf940u, 0x32d86ce3u, 0x45df5c75u, 0xdcd60dcfu, 0xabd13d59u,
+  0x26d930acu, 0x51de003au, 0xc8d75180u, 0xbfd06116u, 0x21b4f4b5u, 0x56b3c423u,
+  0xcfba9599u, 0xb8bda50fu, 0x2802b89eu, 0x5f058808u, 0xc60cd9b2u, 0xb10be924u,
+  0x2f6f7c87u, 0x58684c11u, 0xc1611dabu, 0xb6662d3du, 0x76dc4190u, 0x01db7106u,
+  0x98d220bcu, 0xefd5102au, 0x71b18589u, 0x06b6b51fu, 0x9fbfe4a5u, 0xe8b8d433u,
+  0x7807c9a2u, 0x0f00f934u, 0x9609a88eu, 0xe10e9818u, 0x7f6a0dbbu, 0x086d3d2du,
+  0x91646c97u, 0xe6635c01u, 0x6b6b51f4u, 0x1c6c6162u, 0x856530d8u, 0xf262004eu,
+  0x6c0695edu, 0x1b01a57bu, 0x8208f4c1u, 0xf50fc457u, 0x65b0d9c6u, 0x12b7e950u,
+  0x8bbeb8eau, 0xfcb9887cu, 0x62dd1ddfu, 0x15da2d49u, 0x8cd37cf3u, 0xfbd44c65u,
+  0x4db26158u, 0x3ab551ceu, 0xa3bc0074u, 0xd4bb30e2u, 0x4adfa541u, 0x3dd895d7u,
+  0xa4d1c46du, 0xd3d6f4fbu, 0x4369e96au, 0x346ed9fcu, 0xad678846u, 0xda60b8d0u,
+  0x44042d73u, 0x33031de5u, 0xaa0a4c5fu, 0xdd0d7cc9u, 0x5005713cu, 0x270241aau,
+  0xbe0b1010u, 0xc90c2086u, 0x5768b525u, 0x206f85b3u, 0xb966d409u, 0xce61e49fu,
+  0x5edef90eu, 0x29d9c998u, 0xb0d09822u, 0xc7d7a8b4u, 0x59b33d17u, 0x2eb40d81u,
+  0xb7bd5c3bu, 0xc0ba6cadu, 0xedb88320u, 0x9abfb3b6u, 0x03b6e20cu, 0x74b1d29au,
+  0xead54739u, 0x9dd277afu, 0x04db2615u, 0x73dc1683u, 0xe3630b12u, 0x94643b84u,
+  0x0d6d6a3eu, 0x7a6a5aa8u, 0xe40ecf0bu, 0x9309ff9du, 0x0a00ae27u, 0x7d079eb1u,
+  0xf00f9344u, 0x8708a3d2u, 0x1e01f268u, 0x6906c2feu, 0xf762575du, 0x806567cbu,
+  0x196c3671u, 0x6e6b06e7u, 0xfed41b76u, 0x89d32be0u, 0x10da7a5au, 0x67dd4accu,
+  0xf9b9df6fu, 0x8ebeeff9u, 0x17b7be43u, 0x60b08ed5u, 0xd6d6a3e8u, 0xa1d1937eu,
+  0x38d8c2c4u, 0x4fdff252u, 0xd1bb67f1u, 0xa6bc5767u, 0x3fb506ddu, 0x48b2364bu,
+  0xd80d2bdau, 0xaf0a1b4cu, 0x36034af6u, 0x41047a60u, 0xdf60efc3u, 0xa867df55u,
+  0x316e8eefu, 0x4669be79u, 0xcb61b38cu, 0xbc66831au, 0x256fd2a0u, 0x5268e236u,
+  0xcc0c7795u, 0xbb0b4703u, 0x220216b9u, 0x5505262fu, 0xc5ba3bbeu, 0xb2bd0b28u,
+  0x2bb45a92u, 0x5cb36a04u, 0xc2d7ffa7u, 0xb5d0cf31u, 0x2cd99e8bu, 0x5bdeae1du,
+  0x9b64c2b0u, 0xec63f226u, 0x756aa39cu, 0x026d930au, 0x9c0906a9u, 0xeb0e363fu,
+  0x72076785u, 0x05005713u, 0x95bf4a82u, 0xe2b87a14u, 0x7bb12baeu, 0x0cb61b38u,
+  0x92d28e9bu, 0xe5d5be0du, 0x7cdcefb7u, 0x0bdbdf21u, 0x86d3d2d4u, 0xf1d4e242u,
+  0x68ddb3f8u, 0x1fda836eu, 0x81be16cdu, 0xf6b9265bu, 0x6fb077e1u, 0x18b74777u,
+  0x88085ae6u, 0xff0f6a70u, 0x66063bcau, 0x11010b5cu, 0x8f659effu, 0xf862ae69u,
+  0x616bffd3u, 0x166ccf45u, 0xa00ae278u, 0xd70dd2eeu, 0x4e048354u, 0x3903b3c2u,
+  0xa7672661u, 0xd06016f7u, 0x4969474du, 0x3e6e77dbu, 0xaed16a4au, 0xd9d65adcu,
+  0x40df0b66u, 0x37d83bf0u, 0xa9bcae53u, 0xdebb9ec5u, 0x47b2cf7fu, 0x30b5ffe9u,
+  0xbdbdf21cu, 0xcabac28au, 0x53b39330u, 0x24b4a3a6u, 0xbad03605u, 0xcdd70693u,
+  0x54de5729u, 0x23d967bfu, 0xb3667a2eu, 0xc4614ab8u, 0x5d681b02u, 0x2a6f2b94u,
+  0xb40bbe37u, 0xc30c8ea1u, 0x5a05df1bu, 0x2d02ef8du
+};
+
+// LZ77 output symbol, a literal byte (distance 0) or a match.
+typedef struct {
+  uint16_t length; // Literal byte or match length.
+  uint16_t distance;
+} symbol_t;
+
+// Huffman code table for one alphabet. (codes are stored bit reversed, ready to write)
+typedef struct {
+  uint16_t codes[FIXED_LITLEN_CODES];
+  uint8_t lengths[FIXED_LITLEN_CODES];
+} huffman_t;
+
+struct deflate {
+  deflate_sink sink;
+  void* sink_context;
+  deflate_format format;
+  int level;
+  level_config_t config;
+  uint32_t checksum;
+  uint32_t total_in;
+
+  // Window holds the last WINDOW_SIZE bytes of history followed by lookahead.
+  unsigned char window[2 * WINDOW_SIZE];
+  int window_end;  // Bytes in window.
+  int pos;         // Next position to compress.
+  int block_start; // Start of input covered by the current block.
+  int symbol_end;  // End of input covered by the symbols so far.
+  int head[HASH_SIZE];  // Most recent position of each hash, -1 if none.
+  int prev[WINDOW_SIZE]; // Previous position with the same hash (chain), by position & WINDOW_MASK.
+
+  // Lazy matching state.
+  int match_length;
+  int match_distance;
+  bool match_available; // Literal at pos - 1 is not yet emitted.
+
+  symbol_t symbols[MAX_SYMBOLS];
+  int num_symbols;
+
+  huffman_t fixed_litlen;
+  huffman_t fixed_dist;
+
+  uint64_t bits;
+  int bit_count;
+  unsigned char out[OUT_BUFFER_SIZE];
+  size_t out_length;
+};
+
+// Returns crc32 of data continuing from crc. (start with 0)
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length) {
+  const unsigned char* p = data;
+  crc = ~crc;
+  while (length--) {
+    crc = CRC_TABLE[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// Helper to update adler32 checksum. (start with 1)
+static uint32_t adler32_update(uint32_t adler, const unsigned char* p, size_t length) {
+  uint32_t a = adler & 0xffff;
+  uint32_t b = adler >> 16;
+  while (length > 0) {
+    // Largest run before b can overflow 32 bits.
+    size_t chunk = length < 5552 ? length : 5552;
+    length -= chunk;
+    while (chunk--) {
+      a += *p++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+
+// Helper to hand buffered compressed bytes to the sink.
+static void flush_out(deflate_t* d) {
+  if (d->out_length > 0) {
+    d->sink(d->sink_context, d->out, d->out_length);
+    d->out_length = 0;
+  }
+}
+
+// Helper to write byte of output.
+static void put_byte(deflate_t* d, unsigned char byte) {
+  if (d->out_length == OUT_BUFFER_SIZE) {
+    flush_out(d);
+  }
+  d->out[d->out_length++] = byte;
+}
+
+// Helper to write count (up to 32) bits of value, least significant first.
+static void put_bits(deflate_t* d, uint32_t value, int count) {
+  d->bits |= (uint64_t)value << d->bit_count;
+  d->bit_count += count;
+  while (d->bit_count >= 8) {
+    put_byte(d, d->bits & 0xff);
+    d->bits >>= 8;
+    d->bit_count -= 8;
+  }
+}
+
+// Helper to pad with zero bits up to a byte boundary.
+static void align_byte(deflate_t* d) {
+  if (d->bit_count > 0) {
+    put_bits(d, 0, 8 - d->bit_count);
+  }
+}
+
+// Helper to assign canonical (bit reversed) codes from code lengths.
+static void assign_codes(huffman_t* h, int n) {
+  int bl_count[MAX_BITS + 1] = { 0 };
+  int next_code[MAX_BITS + 1];
+
+  for (int i = 0; i < n; i++) {
+    bl_count[h->lengths[i]]++;
+  }
+  bl_count[0] = 0;
+
+  int code = 0;
+  for (int bits = 1; bits <= MAX_BITS; bits++) {
+    code = (code + bl_count[bits - 1]) << 1;
+    next_code[bits] = code;
+  }
+
+  for (int i = 0; i < n; i++) {
+    int length = h->lengths[i];
+    if (length == 0) {
+      continue;
+    }
+    int c = next_code[length]++;
+    int reversed = 0;
+    for (int b = 0; b < length; b++) {
+      reversed = (reversed << 1) | (c & 1);
+      c >>= 1;
+    }
+    h->codes[i] = reversed;
+  }
+}
+
+// Helper to build Huffman code lengths (no longer than limit) for symbol frequencies.
+static void build_lengths(const uint32_t* freq, int n, int limit, uint8_t* lengths) {
+  uint32_t weights[FIXED_LITLEN_CODES];
+  int leaves[FIXED_LITLEN_CODES];
+  uint32_t node_weight[2 * FIXED_LITLEN_CODES];
+  int parent[2 * FIXED_LITLEN_CODES];
+  int depth[2 * FIXED_LITLEN_CODES];
+
+  memcpy(weights, freq, sizeof(uint32_t) * n);
+
+  for (;;) {
+    int num_leaves = 0;
+    for (int i = 0; i < n; i++) {
+      lengths[i] = 0;
+      if (weights[i] > 0) {
+        // Insertion sort by weight (stable so equal weights keep symbol order).
+        int j = num_leaves++;
+        while (j > 0 && weights[leaves[j - 1]] > weights[i]) {
+          leaves[j] = leaves[j - 1];
+          j--;
+        }
+        leaves[j] = i;
+      }
+    }
+
+    if (num_leaves == 0) {
+      return;
+    }
+    if (num_leaves == 1) {
+      lengths[leaves[0]] = 1;
+      return;
+    }
+
+    // Two queue construction: sorted leaves, and internal nodes which come out sorted.
+    for (int i = 0; i < num_leaves; i++) {
+      node_weight[i] = weights[leaves[i]];
+    }
+    int next_leaf = 0;
+    int next_internal = num_leaves;
+    int num_nodes = num_leaves;
+    while (num_nodes < 2 * num_leaves - 1) {
+      int pick[2];
+      for (int k = 0; k < 2; k++) {
+        if (next_leaf < num_leaves &&
+            (next_internal >= num_nodes || node_weight[next_leaf] <= node_weight[next_internal])) {
+          pick[k] = next_leaf++;
+        } else {
+          pick[k] = next_internal++;
+        }
+      }
+      node_weight[num_nodes] = node_weight[pick[0]] + node_weight[pick[1]];
+      parent[pick[0]] = num_nodes;
+      parent[pick[1]] = num_nodes;
+      num_nodes++;
+    }
+
+    // Depths from the root (last node) down.
+    int max_depth = 0;
+    depth[num_nodes - 1] = 0;
+    for (int i = num_nodes - 2; i >= 0; i--) {
+      depth[i] = depth[parent[i]] + 1;
+      if (depth[i] > max_depth) {
+        max_depth = depth[i];
+      }
+    }
+
+    if (max_depth <= limit) {
+      for (int i = 0; i < num_leaves; i++) {
+        lengths[leaves[i]] = depth[i];
+      }
+      return;
+    }
+
+    // Too deep, flatten the frequencies and try again.
+    for (int i = 0; i < n; i++) {
+      if (weights[i] > 0) {
+        weights[i] = (weights[i] >> 1) | 1;
+      }
+    }
+  }
+}
+
+// Helper to get length code index (0-28) of match length.
+static int length_code(int length) {
+  return LENGTH_CODE[length - MIN_MATCH];
+}
+
+// Helper to get distance code of match distance.
+static int dist_code(int distance) {
+  return distance <= 256 ? DIST_CODE_LOW[distance - 1] : DIST_CODE_HIGH[(distance - 1) >> 7];
+}
+
+// Helper to write a stored (uncompressed) block(s) of the current block's input.
+static void write_stored(deflate_t* d, bool final) {
+  const unsigned char* p = d->window + d->block_start;
+  int remaining = d->symbol_end - d->block_start;
+
+  do {
+    int chunk = remaining < MAX_STORED ? remaining : MAX_STORED;
+    bool last = final && chunk == remaining;
+
+    put_bits(d, last ? 1 : 0, 3); // BFINAL, BTYPE 00.
+    align_byte(d);
+    put_byte(d, chunk & 0xff);
+    put_byte(d, chunk >> 8);
+    put_byte(d, ~chunk & 0xff);
+    put_byte(d, (~chunk >> 8) & 0xff);
+    for (int i = 0; i < chunk; i++) {
+      put_byte(d, p[i]);
+    }
+
+    p += chunk;
+    remaining -= chunk;
+  } while (remaining > 0);
+}
+
+// Helper to write the current block's symbols with litlen and dist codes.
+static void write_symbols(deflate_t* d, const huffman_t* litlen, const huffman_t* dist) {
+  for (int i = 0; i < d->num_symbols; i++) {
+    symbol_t s = d->symbols[i];
+    if (s.distance == 0) {
+      put_bits(d, litlen->codes[s.length], litlen->lengths[s.length]);
+    } else {
+      int lc = length_code(s.length);
+      put_bits(d, litlen->codes[257 + lc], litlen->lengths[257 + lc]);
+      put_bits(d, s.length - LENGTH_BASE[lc], LENGTH_EXTRA[lc]);
+      int dc = dist_code(s.distance);
+      put_bits(d, dist->codes[dc], dist->lengths[dc]);
+      put_bits(d, s.distance - DIST_BASE[dc], DIST_EXTRA[dc]);
+    }
+  }
+  put_bits(d, litlen->codes[END_OF_BLOCK], litlen->lengths[END_OF_BLOCK]);
+}
+
+// Helper to run length encode code lengths into code length alphabet symbols and their extra bits.
+static int encode_code_lengths(const uint8_t* lengths, int n, uint8_t* symbols, uint8_t* extras) {
+  int count = 0;
+  int i = 0;
+  while (i < n) {
+    int length = lengths[i];
+    int run = 1;
+    while (i + run < n && lengths[i + run] == length) {
+      run++;
+    }
+    i += run;
+
+    if (length == 0) {
+      while (run >= 11) {
+        int r = run < 138 ? run : 138;
+        symbols[count] = 18;
+        extras[count++] = r - 11;
+        run -= r;
+      }
+      if (run >= 3) {
+        symbols[count] = 17;
+        extras[count++] = run - 3;
+        run = 0;
+      }
+    } else {
+      symbols[count] = length;
+      extras[count++] = 0;
+      run--;
+      while (run >= 3) {
+        int r = run < 6 ? run : 6;
+        symbols[count] = 16;
+        extras[count++] = r - 3;
+        run -= r;
+      }
+    }
+    while (run-- > 0) {
+      symbols[count] = length;
+      extras[count++] = 0;
+    }
+  }
+  return count;
+}
+
+// Writes out the current block in whichever block type is smallest, then starts a new block.
+static void write_block(deflate_t* d, bool final) {
+  if (d->level == 0) {
+    write_stored(d, final);
+    d->block_start = d->symbol_end;
+    return;
+  }
+
+  uint32_t litlen_freq[LITLEN_CODES] = { 0 };
+  uint32_t dist_freq[DIST_CODES] = { 0 };
+  long extra_bits = 0;
+  for (int i = 0; i < d->num_symbols; i++) {
+    symbol_t s = d->symbols[i];
+    if (s.distance == 0) {
+      litlen_freq[s.length]++;
+    } else {
+      int lc = length_code(s.length);
+      int dc = dist_code(s.distance);
+      litlen_freq[257 + lc]++;
+      dist_freq[dc]++;
+      extra_bits += LENGTH_EXTRA[lc] + DIST_EXTRA[dc];
+    }
+  }
+  litlen_freq[END_OF_BLOCK] = 1;
+
+  // Dynamic codes for this block.
+  huffman_t litlen;
+  huffman_t dist;
+  build_lengths(litlen_freq, LITLEN_CODES, MAX_BITS, litlen.lengths);
+  build_lengths(dist_freq, DIST_CODES, MAX_BITS, dist.lengths);
+
+  int hlit = LITLEN_CODES;
+  while (hlit > 257 && litlen.lengths[hlit - 1] == 0) hlit--;
+  int hdist = DIST_CODES;
+  while (hdist > 1 && dist.lengths[hdist - 1] == 0) hdist--;
+  if (hdist == 1 && dist.lengths[0] == 0) {
+    // At least one distance code has to be described.
+    dist.lengths[0] = 1;
+  }
+
+  uint8_t all_lengths[LITLEN_CODES + DIST_CODES];
+  memcpy(all_lengths, litlen.lengths, hlit);
+  memcpy(all_lengths + hlit, dist.lengths, hdist);
+  uint8_t cl_symbols[LITLEN_CODES + DIST_CODES];
+  uint8_t cl_extras[LITLEN_CODES + DIST_CODES];
+  int num_cl_symbols = encode_code_lengths(all_lengths, hlit + hdist, cl_symbols, cl_extras);
+
+  uint32_t cl_freq[CODELEN_CODES] = { 0 };
+  for (int i = 0; i < num_cl_symbols; i++) {
+    cl_freq[cl_symbols[i]]++;
+  }
+  huffman_t codelen;
+  build_lengths(cl_freq, CODELEN_CODES, MAX_CODELEN_BITS, codelen.lengths);
+  int hclen = CODELEN_CODES;
+  while (hclen > 4 && codelen.lengths[CODELEN_ORDER[hclen - 1]] == 0) hclen--;
+
+  // Compare sizes of each block type.
+  long dynamic_bits = 3 + 14 + 3 * hclen + extra_bits;
+  for (int i = 0; i < CODELEN_CODES; i++) {
+    dynamic_bits += (long)cl_freq[i] * codelen.lengths[i];
+  }
+  dynamic_bits += 2 * cl_freq[16] + 3 * cl_freq[17] + 7 * cl_freq[18];
+  long fixed_bits = 3 + extra_bits;
+  for (int i = 0; i < LITLEN_CODES; i++) {
+    dynamic_bits += (long)litlen_freq[i] * litlen.lengths[i];
+    fixed_bits += (long)litlen_freq[i] * d->fixed_litlen.lengths[i];
+  }
+  for (int i = 0; i < DIST_CODES; i++) {
+    dynamic_bits += (long)dist_freq[i] * dist.lengths[i];
+    fixed_bits += (long)dist_freq[i] * d->fixed_dist.lengths[i];
+  }
+  int stored_length = d->symbol_end - d->block_start;
+  long stored_bits = ((long)stored_length + 5 * (stored_length / MAX_STORED + 1)) * 8 + 7;
+
+  if (stored_bits <= fixed_bits && stored_bits <= dynamic_bits) {
+    write_stored(d, final);
+  } else if (fixed_bits <= dynamic_bits) {
+    put_bits(d, final ? 1 : 0, 1);
+    put_bits(d, 1, 2);
+    write_symbols(d, &d->fixed_litlen, &d->fixed_dist);
+  } else {
+    assign_codes(&litlen, hlit);
+    assign_codes(&dist, hdist);
+    assign_codes(&codelen, CODELEN_CODES);
+
+    put_bits(d, final ? 1 : 0, 1);
+    put_bits(d, 2, 2);
+    put_bits(d, hlit - 257, 5);
+    put_bits(d, hdist - 1, 5);
+    put_bits(d, hclen - 4, 4);
+    for (int i = 0; i < hclen; i++) {
+      put_bits(d, codelen.lengths[CODELEN_ORDER[i]], 3);
+    }
+    for (int i = 0; i < num_cl_symbols; i++) {
+      int s = cl_symbols[i];
+      put_bits(d, codelen.codes[s], codelen.lengths[s]);
+      if (s == 16) put_bits(d, cl_extras[i], 2);
+      else if (s == 17) put_bits(d, cl_extras[i], 3);
+      else if (s == 18) put_bits(d, cl_extras[i], 7);
+    }
+    write_symbols(d, &litlen, &dist);
+  }
+
+  d->num_symbols = 0;
+  d->block_start = d->symbol_end;
+}
+
+// Helper to add symbol covering size input bytes, writing the block once the buffer is full.
+static void emit_symbol(deflate_t* d, int length, int distance, int size) {
+  d->symbols[d->num_symbols].length = length;
+  d->symbols[d->num_symbols].distance = distance;
+  d->num_symbols++;
+  d->symbol_end += size;
+
+  if (d->num_symbols == MAX_SYMBOLS) {
+    write_block(d, false);
+  }
+}
+
+// Helper to add position to its hash chain, returns the previous position with the same hash.
+static int insert_hash(deflate_t* d, int pos) {
+  const unsigned char* p = d->window + pos;
+  uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+  uint32_t hash = (v * 2654435761u) >> (32 - HASH_BITS);
+
+  int candidate = d->head[hash];
+  d->prev[pos & WINDOW_MASK] = candidate;
+  d->head[hash] = pos;
+  return candidate;
+}
+
+// Helper to find longest match (longer than best_length) for pos along the hash chain from candidate.
+// Returns best_length if there is no longer match.
+static int longest_match(deflate_t* d, int candidate, int best_length, int* distance) {
+  int max_length = d->window_end - d->pos;
+  if (max_length > MAX_MATCH) max_length = MAX_MATCH;
+  if (best_length >= max_length) {
+    return best_length;
+  }
+
+  int nice_length = d->config.nice_length < max_length ? d->config.nice_length : max_length;
+  int chain = d->config.max_chain;
+  if (best_length >= d->config.good_length) {
+    chain >>= 2;
+  }
+
+  const unsigned char* scan = d->window + d->pos;
+  int limit = d->pos - WINDOW_SIZE;
+  while (candidate > limit && chain-- > 0) {
+    const unsigned char* match = d->window + candidate;
+    // Cheap checks first: the byte that would make this match longer, then the start.
+    if (match[best_length] == scan[best_length] && match[0] == scan[0] && match[1] == scan[1]) {
+      int length = 2;
+      while (length < max_length && match[length] == scan[length]) {
+        length++;
+      }
+      if (length > best_length) {
+        best_length = length;
+        *distance = d->pos - candidate;
+        if (length >= nice_length) {
+          break;
+        }
+      }
+    }
+
+    int next = d->prev[candidate & WINDOW_MASK];
+    if (next >= candidate) {
+      break; // Chain entry was overwritten by newer data.
+    }
+    candidate = next;
+  }
+  return best_length;
+}
+
+// Helper to compress with greedy matching (fast levels).
+static void compress_greedy(deflate_t* d, bool flush) {
+  while (d->pos < d->window_end) {
+    if (!flush && d->window_end - d->pos < MIN_LOOKAHEAD) {
+      break; // Wait for more input.
+    }
+
+    int length = 0;
+    int distance = 0;
+    if (d->window_end - d->pos >= MIN_MATCH) {
+      int candidate = insert_hash(d, d->pos);
+      if (candidate >= 0) {
+        length = longest_match(d, candidate, MIN_MATCH - 1, &distance);
+      }
+    }
+
+    if (length >= MIN_MATCH) {
+      emit_symbol(d, length, distance, length);
+      // Hash the positions inside short matches too so later data can match them.
+      if (length <= d->config.max_lazy) {
+        for (int p = d->pos + 1; p < d->pos + length && p + MIN_MATCH <= d->window_end; p++) {
+          insert_hash(d, p);
+        }
+      }
+      d->pos += length;
+    } else {
+      emit_symbol(d, d->window[d->pos], 0, 1);
+      d->pos++;
+    }
+  }
+}
+
+// Helper to compress with lazy matching: a match is only taken if the next position doesn't have a longer one.
+static void compress_lazy(deflate_t* d, bool flush) {
+  while (d->pos < d->window_end) {
+    if (!flush && d->window_end - d->pos < MIN_LOOKAHEAD) {
+      break; // Wait for more input.
+    }
+
+    int candidate = -1;
+    if (d->window_end - d->pos >= MIN_MATCH) {
+      candidate = insert_hash(d, d->pos);
+    }
+
+    // Match at pos - 1 versus match at pos.
+    int prev_length = d->match_length;
+    int prev_distance = d->match_distance;
+    d->match_length = MIN_MATCH - 1;
+    if (candidate >= 0 && prev_length < d->config.max_lazy) {
+      d->match_length = longest_match(d, candidate, prev_length, &d->match_distance);
+      if (d->match_length == MIN_MATCH && d->match_distance > TOO_FAR) {
+        d->match_length = MIN_MATCH - 1;
+      }
+    }
+
+    if (prev_length >= MIN_MATCH && d->match_length <= prev_length) {
+      // Match at pos - 1 is at least as good, take it.
+      emit_symbol(d, prev_length, prev_distance, prev_length);
+      int end = d->pos - 1 + prev_length;
+      for (int p = d->pos + 1; p < end && p + MIN_MATCH <= d->window_end; p++) {
+        insert_hash(d, p);
+      }
+      d->pos = end;
+      d->match_available = false;
+      d->match_length = MIN_MATCH - 1;
+    } else if (d->match_available) {
+      // Match at pos is better (or there is none), byte at pos - 1 is a literal.
+      emit_symbol(d, d->window[d->pos - 1], 0, 1);
+      d->pos++;
+    } else {
+      d->match_available = true;
+      d->pos++;
+    }
+  }
+
+  if (flush && d->match_available) {
+    emit_symbol(d, d->window[d->pos - 1], 0, 1);
+    d->match_available = false;
+  }
+}
+
+// Helper to compress the window's data. (keeps MIN_LOOKAHEAD bytes unless flushing)
+static void compress(deflate_t* d, bool flush) {
+  if (d->level == 0) {
+    d->pos = d->window_end;
+    d->symbol_end = d->pos;
+    if (d->symbol_end - d->block_start >= MAX_STORED) {
+      write_block(d, false);
+    }
+  } else if (d->config.lazy) {
+    compress_lazy(d, flush);
+  } else {
+    compress_greedy(d, flush);
+  }
+}
+
+// Helper to move the upper half of the window down to make room for more input.
+static void slide_window(deflate_t* d) {
+  // The current block's input would be lost, write it out first.
+  if (d->symbol_end > d->block_start) {
+    write_block(d, false);
+  }
+
+  memmove(d->window, d->window + WINDOW_SIZE, d->window_end - WINDOW_SIZE);
+  d->window_end -= WINDOW_SIZE;
+  d->pos -= WINDOW_SIZE;
+  d->block_start -= WINDOW_SIZE;
+  d->symbol_end -= WINDOW_SIZE;
+
+  for (int i = 0; i < HASH_SIZE; i++) {
+    d->head[i] = d->head[i] >= WINDOW_SIZE ? d->head[i] - WINDOW_SIZE : -1;
+  }
+  for (int i = 0; i < WINDOW_SIZE; i++) {
+    d->prev[i] = d->prev[i] >= WINDOW_SIZE ? d->prev[i] - WINDOW_SIZE : -1;
+  }
+}
+
+// Helper to write the stream header of the format.
+static void write_header(deflate_t* d) {
+  if (d->format == DEFLATE_ZLIB) {
+    int cmf = 0x78; // Deflate, 32K window.
+    int level_flag = d->level < 2 ? 0 : d->level < 6 ? 1 : d->level == 6 ? 2 : 3;
+    int flg = level_flag << 6;
+    flg += 31 - (cmf * 256 + flg) % 31;
+    put_byte(d, cmf);
+    put_byte(d, flg);
+  } else if (d->format == DEFLATE_GZIP) {
+    static const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+    for (int i = 0; i < 10; i++) {
+      put_byte(d, header[i]);
+    }
+  }
+}
+
+// Creates compressor that hands compressed bytes to sink.
+deflate_t* deflate_create(deflate_format format, int level, deflate_sink sink, void* sink_context) {
+  deflate_t* d = malloc(sizeof(deflate_t));
+  if (d == NULL) {
+    return NULL;
+  }
+
+  if (level < 0) level = 0;
+  if (level > 9) level = 9;
+
+  d->sink = sink;
+  d->sink_context = sink_context;
+  d->format = format;
+  d->level = level;
+  d->config = LEVELS[level];
+  d->checksum = format == DEFLATE_ZLIB ? 1 : 0;
+  d->total_in = 0;
+  d->window_end = 0;
+  d->pos = 0;
+  d->block_start = 0;
+  d->symbol_end = 0;
+  d->match_length = MIN_MATCH - 1;
+  d->match_distance = 0;
+  d->match_available = false;
+  d->num_symbols = 0;
+  d->bits = 0;
+  d->bit_count = 0;
+  d->out_length = 0;
+
+  for (int i = 0; i < HASH_SIZE; i++) {
+    d->head[i] = -1;
+  }
+  for (int i = 0; i < WINDOW_SIZE; i++) {
+    d->prev[i] = -1;
+  }
+
+  // Fixed codes (RFC 1951 3.2.6).
+  for (int i = 0; i < FIXED_LITLEN_CODES; i++) {
+    d->fixed_litlen.lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+  }
+  for (int i = 0; i < DIST_CODES; i++) {
+    d->fixed_dist.lengths[i] = 5;
+  }
+  assign_codes(&d->fixed_litlen, FIXED_LITLEN_CODES);
+  assign_codes(&d->fixed_dist, DIST_CODES);
+
+  write_header(d);
+  return d;
+}
+
+// Helper sink that writes to a file.
+static void file_sink(void* context, const unsigned char* data, size_t length) {
+  fwrite(data, 1, length, (FILE*)context);
+}
+
+// Creates compressor that writes compressed bytes to out.
+deflate_t* deflate_create_file(deflate_format format, int level, FILE* out) {
+  return deflate_create(format, level, file_sink, out);
+}
+
+// Compresses data, output is produced as soon as full blocks are ready.
+void deflate_write(deflate_t* d, const void* data, size_t length) {
+  const unsigned char* p = data;
+
+  if (d->format == DEFLATE_ZLIB) {
+    d->checksum = adler32_update(d->checksum, p, length);
+  } else if (d->format == DEFLATE_GZIP) {
+    d->checksum = crc32_update(d->checksum, p, length);
+  }
+  d->total_in += (uint32_t)length;
+
+  while (length > 0) {
+    if (d->window_end == 2 * WINDOW_SIZE) {
+      compress(d, false);
+      slide_window(d);
+    }
+
+    size_t room = 2 * WINDOW_SIZE - d->window_end;
+    size_t n = length < room ? length : room;
+    memcpy(d->window + d->window_end, p, n);
+    d->window_end += n;
+    p += n;
+    length -= n;
+  }
+}
+
+// Compresses remaining input and writes the final block and trailer.
+void deflate_finish(deflate_t* d) {
+  compress(d, true);
+  write_block(d, true);
+  align_byte(d);
+
+  if (d->format == DEFLATE_ZLIB) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      put_byte(d, (d->checksum >> shift) & 0xff);
+    }
+  } else if (d->format == DEFLATE_GZIP) {
+    for (int shift = 0; shift < 32; shift += 8) {
+      put_byte(d, (d->checksum >> shift) & 0xff);
+    }
+    for (int shift = 0; shift < 32; shift += 8) {
+      put_byte(d, (d->total_in >> shift) & 0xff);
+    }
+  }
+
+  flush_out(d);
+}
+
+// Frees compressor memory. (doesn't finish the stream)
+void deflate_free(deflate_t* d) {
+  free(d);
+}
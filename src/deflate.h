@@ -0,0 +1,37 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Stream container formats.
+typedef enum {
+  DEFLATE_RAW,  // Bare DEFLATE blocks.
+  DEFLATE_ZLIB, // zlib wrapper (adler32 trailer), used by png.
+  DEFLATE_GZIP  // gzip wrapper (crc32 trailer), used by .svgz files.
+} deflate_format;
+
+// Receives compressed bytes as they are produced.
+typedef void (*deflate_sink)(void* context, const unsigned char* data, size_t length);
+
+// Streaming compressor. (opaque, see deflate.c)
+typedef struct deflate deflate_t;
+
+#define DEFLATE_DEFAULT_LEVEL 6
+
+// Creates compressor that hands compressed bytes to sink.
+// Level 0 only stores, 1 is fastest, 9 compresses the most.
+deflate_t* deflate_create(deflate_format format, int level, deflate_sink sink, void* sink_context);
+// Creates compressor that writes compressed bytes to out.
+deflate_t* deflate_create_file(deflate_format format, int level, FILE* out);
+// Compresses data, output is produced as soon as full blocks are ready.
+void deflate_write(deflate_t* d, const void* data, size_t length);
+// Compresses remaining input and writes the final block and trailer.
+void deflate_finish(deflate_t* d);
+// Frees compressor memory. (doesn't finish the stream)
+void deflate_free(deflate_t* d);
+// Returns crc32 of data continuing from crc. (start with 0)
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+
+// Built-in bitmap font for printable ascii (' ' to '~').
+// Each glyph is FONT_GLYPH_HEIGHT rows of FONT_GLYPH_WIDTH bits (most significant bit is the left column).
+// Rows 0 to FONT_CAP_HEIGHT - 1 are the body, the rest are for descenders.
+#define FONT_GLYPH_WIDTH 5
+#define FONT_GLYPH_HEIGHT 9
+#define FONT_CAP_HEIGHT 7
+#define FONT_ADVANCE 6 // Glyph width plus spacing.
+#define FONT_FIRST_CHAR ' '
+#define FONT_LAST_CHAR '~'
+
+extern const uint8_t FONT_GLYPHS[FONT_LAST_CHAR - FONT_FIRST_CHAR + 1][FONT_GLYPH_HEIGHT];
+
+// Returns glyph rows for char, '?' for chars the font doesn't have.
+const uint8_t* font_glyph(char c);
+
+#endif
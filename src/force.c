@@ -0,0 +1,346 @@
+#include "force.h"
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Simulation steps, the temperature (largest move per step) cools down linearly over them.
+#define ITERATIONS 300
+// Barnes-Hut accuracy, cells smaller than THETA times their distance are treated as one body.
+#define THETA 0.9f
+// Bodies per quadtree leaf, leaves are summed directly. (4 at a time with SSE2)
+#define LEAF_SIZE 16
+// Deeper cells are leaves no matter how many bodies they hold, so stacked up bodies end the split.
+#define MAX_DEPTH 32
+// Bodies per repulsion task.
+#define CHUNK_SIZE 256
+// Share of the velocity kept from the previous step.
+#define FRICTION 0.5f
+// Pull towards the center, keeps unconnected parts from drifting apart.
+#define GRAVITY 0.5f
+
+// Quadtree cell, its bodies are sorted_x/sorted_y[start] up to [start + count].
+typedef struct {
+  float center_x; // Center of mass.
+  float center_y;
+  float size;     // Side length.
+  int start;
+  int count;
+  int child[4];   // -1 if there is no child in that quadrant, all -1 for leaves.
+} cell_t;
+
+// Simulation state. Per node values are kept as separate arrays (structure of arrays) so loops over them vectorize.
+typedef struct {
+  graph_t* g;
+  int n;
+  float spacing;  // Preferred edge length.
+  float* x;
+  float* y;
+  float* vx;
+  float* vy;
+  float* fx;
+  float* fy;
+  int* order;     // Node ids in quadtree order.
+  float* sorted_x;
+  float* sorted_y;
+  float* sorted_fx;
+  float* sorted_fy;
+  cell_t* cells;
+  int num_cells;
+  int cells_capacity;
+} force_t;
+
+static void free_force(force_t* f) {
+  free(f->x);
+  free(f->y);
+  free(f->vx);
+  free(f->vy);
+  free(f->fx);
+  free(f->fy);
+  free(f->order);
+  free(f->sorted_x);
+  free(f->sorted_y);
+  free(f->sorted_fx);
+  free(f->sorted_fy);
+  free(f->cells);
+}
+
+// Helper to swap bodies i and j of the quadtree order.
+static void swap_bodies(force_t* f, int i, int j) {
+  float x = f->sorted_x[i];
+  float y = f->sorted_y[i];
+  int node = f->order[i];
+  f->sorted_x[i] = f->sorted_x[j];
+  f->sorted_y[i] = f->sorted_y[j];
+  f->order[i] = f->order[j];
+  f->sorted_x[j] = x;
+  f->sorted_y[j] = y;
+  f->order[j] = node;
+}
+
+// Helper to move bodies in [start, end) with (x or y) < split to the front, returns where the rest start.
+static int partition_bodies(force_t* f, int start, int end, bool by_x, float split) {
+  int i = start;
+  for (int j = start; j < end; j++) {
+    float value = by_x ? f->sorted_x[j] : f->sorted_y[j];
+    if (value < split) {
+      swap_bodies(f, i++, j);
+    }
+  }
+  return i;
+}
+
+// Builds cell for bodies [start, start + count) inside the square at (x0, y0), returns its index or -1.
+// Bodies are partitioned in place, so every cell's bodies stay contiguous.
+static int build_cell(force_t* f, int start, int count, float x0, float y0, float size, int depth) {
+  if (f->num_cells >= f->cells_capacity) {
+    int new_capacity = f->cells_capacity * 2;
+    cell_t* cells = realloc(f->cells, sizeof(cell_t) * new_capacity);
+    if (cells == NULL) {
+      return -1;
+    }
+    f->cells = cells;
+    f->cells_capacity = new_capacity;
+  }
+  int index = f->num_cells++;
+
+  float sum_x = 0.0f;
+  float sum_y = 0.0f;
+  for (int i = start; i < start + count; i++) {
+    sum_x += f->sorted_x[i];
+    sum_y += f->sorted_y[i];
+  }
+  cell_t cell = {
+    .center_x = sum_x / count,
+    .center_y = sum_y / count,
+    .size = size,
+    .start = start,
+    .count = count,
+    .child = { -1, -1, -1, -1 },
+  };
+
+  if (count > LEAF_SIZE && depth < MAX_DEPTH) {
+    float half = size / 2;
+    int end = start + count;
+    int middle = partition_bodies(f, start, end, false, y0 + half);
+    // Quadrant q (top left, top right, bottom left, bottom right) holds bodies bounds[q] up to bounds[q + 1].
+    int bounds[5] = { start, partition_bodies(f, start, middle, true, x0 + half),
+                      middle, partition_bodies(f, middle, end, true, x0 + half), end };
+    for (int q = 0; q < 4; q++) {
+      if (bounds[q + 1] > bounds[q]) {
+        cell.child[q] = build_cell(f, bounds[q], bounds[q + 1] - bounds[q], x0 + (q % 2) * half, y0 + (q / 2) * half, half, depth + 1);
+      }
+    }
+  }
+
+  f->cells[index] = cell;
+  return index;
+}
+
+// Sums the repulsion of a leaf's bodies on a body at (x, y). (the body itself adds nothing)
+static void leaf_forces(const float* xs, const float* ys, int count, float x, float y, float strength, float* fx, float* fy) {
+  float sum_x = 0.0f;
+  float sum_y = 0.0f;
+  int j = 0;
+#ifdef __SSE2__
+  __m128 px = _mm_set1_ps(x);
+  __m128 py = _mm_set1_ps(y);
+  __m128 k = _mm_set1_ps(strength);
+  __m128 min_distance = _mm_set1_ps(1.0f);
+  __m128 ax = _mm_setzero_ps();
+  __m128 ay = _mm_setzero_ps();
+  for (; j + 4 <= count; j += 4) {
+    __m128 dx = _mm_sub_ps(px, _mm_loadu_ps(xs + j));
+    __m128 dy = _mm_sub_ps(py, _mm_loadu_ps(ys + j));
+    __m128 d2 = _mm_max_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), min_distance);
+    __m128 scale = _mm_div_ps(k, d2);
+    ax = _mm_add_ps(ax, _mm_mul_ps(dx, scale));
+    ay = _mm_add_ps(ay, _mm_mul_ps(dy, scale));
+  }
+  float lanes_x[4];
+  float lanes_y[4];
+  _mm_storeu_ps(lanes_x, ax);
+  _mm_storeu_ps(lanes_y, ay);
+  sum_x = (lanes_x[0] + lanes_x[1]) + (lanes_x[2] + lanes_x[3]);
+  sum_y = (lanes_y[0] + lanes_y[1]) + (lanes_y[2] + lanes_y[3]);
+#endif
+  for (; j < count; j++) {
+    float dx = x - xs[j];
+    float dy = y - ys[j];
+    float d2 = fmaxf(dx * dx + dy * dy, 1.0f);
+    sum_x += dx * strength / d2;
+    sum_y += dy * strength / d2;
+  }
+  *fx += sum_x;
+  *fy += sum_y;
+}
+
+// Task summing the repulsion (spacing^2 / distance, away from each other) on one chunk of bodies.
+static void repulse_chunk(void* context, int index) {
+  force_t* f = context;
+  float strength = f->spacing * f->spacing;
+  int stack[3 * MAX_DEPTH + 4];
+  int end = (index + 1) * CHUNK_SIZE < f->n ? (index + 1) * CHUNK_SIZE : f->n;
+
+  for (int i = index * CHUNK_SIZE; i < end; i++) {
+    float x = f->sorted_x[i];
+    float y = f->sorted_y[i];
+    float fx = 0.0f;
+    float fy = 0.0f;
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      cell_t* cell = &f->cells[stack[--top]];
+      float dx = x - cell->center_x;
+      float dy = y - cell->center_y;
+      float d2 = dx * dx + dy * dy;
+      if (cell->size * cell->size < THETA * THETA * d2) {
+        // Far enough away to count as one body.
+        float scale = strength * cell->count / d2;
+        fx += dx * scale;
+        fy += dy * scale;
+      } else if (cell->child[0] == -1 && cell->child[1] == -1 && cell->child[2] == -1 && cell->child[3] == -1) {
+        leaf_forces(f->sorted_x + cell->start, f->sorted_y + cell->start, cell->count, x, y, strength, &fx, &fy);
+      } else {
+        for (int q = 0; q < 4; q++) {
+          if (cell->child[q] != -1) {
+            stack[top++] = cell->child[q];
+          }
+        }
+      }
+    }
+    f->sorted_fx[i] = fx;
+    f->sorted_fy[i] = fy;
+  }
+}
+
+// Helper to build the quadtree over the current positions. Returns false if memory allocation failed.
+static bool build_tree(force_t* f) {
+  float min_x = f->x[0];
+  float min_y = f->y[0];
+  float max_x = f->x[0];
+  float max_y = f->y[0];
+  for (int i = 0; i < f->n; i++) {
+    int node = f->order[i];
+    f->sorted_x[i] = f->x[node];
+    f->sorted_y[i] = f->y[node];
+    min_x = fminf(min_x, f->x[node]);
+    min_y = fminf(min_y, f->y[node]);
+    max_x = fmaxf(max_x, f->x[node]);
+    max_y = fmaxf(max_y, f->y[node]);
+  }
+
+  // Slightly bigger than the bounds, so the largest coordinates land inside.
+  float size = fmaxf(max_x - min_x, max_y - min_y) * 1.001f + 1.0f;
+  f->num_cells = 0;
+  return build_cell(f, 0, f->n, min_x, min_y, size, 0) != -1;
+}
+
+// One simulation step at temperature.
+static bool step(force_t* f, float temperature, pool_t* pool) {
+  graph_t* g = f->g;
+
+  // Repulsion between all nodes, in quadtree order.
+  if (!build_tree(f)) {
+    return false;
+  }
+  pool_run(pool, repulse_chunk, f, (f->n + CHUNK_SIZE - 1) / CHUNK_SIZE);
+  for (int i = 0; i < f->n; i++) {
+    f->fx[f->order[i]] = f->sorted_fx[i];
+    f->fy[f->order[i]] = f->sorted_fy[i];
+  }
+
+  // Attraction along edges (distance^2 / spacing, towards each other).
+  for (int u = 0; u < f->n; u++) {
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      int v = g->edge_targets[e];
+      float dx = f->x[u] - f->x[v];
+      float dy = f->y[u] - f->y[v];
+      float scale = sqrtf(dx * dx + dy * dy) / f->spacing;
+      f->fx[u] -= dx * scale;
+      f->fy[u] -= dy * scale;
+      f->fx[v] += dx * scale;
+      f->fy[v] += dy * scale;
+    }
+  }
+
+  // Move, limited by the temperature.
+  for (int i = 0; i < f->n; i++) {
+    f->vx[i] = f->vx[i] * FRICTION + f->fx[i] - GRAVITY * f->x[i];
+    f->vy[i] = f->vy[i] * FRICTION + f->fy[i] - GRAVITY * f->y[i];
+    float speed = sqrtf(f->vx[i] * f->vx[i] + f->vy[i] * f->vy[i]);
+    if (speed > temperature) {
+      f->vx[i] *= temperature / speed;
+      f->vy[i] *= temperature / speed;
+    }
+    f->x[i] += f->vx[i];
+    f->y[i] += f->vy[i];
+  }
+  return true;
+}
+
+bool layout_force(graph_t* g, double node_spacing, pool_t* pool) {
+  if (g->num_nodes == 0) {
+    return true;
+  }
+
+  int n = g->num_nodes;
+  force_t f = { .g = g, .n = n, .spacing = node_spacing, .cells_capacity = n / 4 + 16 };
+  f.x = malloc(sizeof(float) * n);
+  f.y = malloc(sizeof(float) * n);
+  f.vx = calloc(n, sizeof(float));
+  f.vy = calloc(n, sizeof(float));
+  f.fx = malloc(sizeof(float) * n);
+  f.fy = malloc(sizeof(float) * n);
+  f.order = malloc(sizeof(int) * n);
+  f.sorted_x = malloc(sizeof(float) * n);
+  f.sorted_y = malloc(sizeof(float) * n);
+  f.sorted_fx = malloc(sizeof(float) * n);
+  f.sorted_fy = malloc(sizeof(float) * n);
+  f.cells = malloc(sizeof(cell_t) * f.cells_capacity);
+  if (!f.x || !f.y || !f.vx || !f.vy || !f.fx || !f.fy || !f.order ||
+      !f.sorted_x || !f.sorted_y || !f.sorted_fx || !f.sorted_fy || !f.cells) {
+    fprintf(g->errors, "Memory allocation failed for force layout.\n");
+    free_force(&f);
+    return false;
+  }
+
+  // Start on a sunflower spiral, evenly spread and the same every run.
+  const float GOLDEN_ANGLE = 3.14159265f * (3.0f - sqrtf(5.0f));
+  for (int i = 0; i < n; i++) {
+    float radius = f.spacing * sqrtf(i + 0.5f);
+    f.x[i] = radius * cosf(i * GOLDEN_ANGLE);
+    f.y[i] = radius * sinf(i * GOLDEN_ANGLE);
+    f.order[i] = i;
+  }
+
+  // Start hot enough to cross the whole layout, end at a fraction of the spacing.
+  float start_temperature = f.spacing * sqrtf(n);
+  float end_temperature = f.spacing / 100;
+  for (int i = 0; i < ITERATIONS; i++) {
+    float t = (float)i / ITERATIONS;
+    if (!step(&f, start_temperature * (1 - t) + end_temperature * t, pool)) {
+      fprintf(g->errors, "Memory allocation failed for force layout.\n");
+      free_force(&f);
+      return false;
+    }
+  }
+
+  // Move top left to (0, 0).
+  float min_x = f.x[0];
+  float min_y = f.y[0];
+  for (int i = 1; i < n; i++) {
+    min_x = fminf(min_x, f.x[i]);
+    min_y = fminf(min_y, f.y[i]);
+  }
+  for (int i = 0; i < n; i++) {
+    g->x[i] = f.x[i] - min_x;
+    g->y[i] = f.y[i] - min_y;
+  }
+
+  free_force(&f);
+  return true;
+}
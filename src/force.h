@@ -0,0 +1,15 @@
+#ifndef FORCE_H
+#define FORCE_H
+
+#include <stdbool.h>
+#include "graph.h"
+#include "pool.h"
+
+// Places every node's x_pos and y_pos with a force directed layout, for graphs without a natural hierarchy.
+// Edges pull their nodes about node_spacing apart while all nodes push each other away; the repulsion is
+// approximated with a Barnes-Hut quadtree and spread over pool's threads. (pool can be NULL)
+// The layout ends up with its top left point at (0, 0).
+// Returns false if memory allocation failed.
+bool layout_force(graph_t* g, double node_spacing, pool_t* pool);
+
+#endif
@@ -1,363 +1,879 @@
 #include "graph.h"
-#include "node.h"
 #include "svg.h"
+#include "raster.h"
+#include "layout.h"
+#include "layered.h"
+#include "force.h"
+#include "component.h"
+#include "binary.h"
+#include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <math.h>
 
 const int RECT_WIDTH = 400;
 const int RECT_HEIGHT = RECT_WIDTH * 0.6;
 
+static bool resize_graph(graph_t* g, int new_capacity);
+
 // Initialize and return a pointer to a graph struct.
-// (Adj matrix representation)
+// (Adjacency list representation, frozen into CSR before layout)
 graph_t* create_graph() {
-  graph_t* g = malloc(sizeof(graph_t));
+  graph_t* g = calloc(1, sizeof(graph_t));
   if (g == NULL) {
     return NULL;
   }
 
-  g->num_nodes = 0;
-  g->capacity = 4; // Initial capacity
-  g->nodes = malloc(sizeof(node_t*) * g->capacity);
-  g->edges = malloc(sizeof(int*) * g->capacity);
-  g->title = malloc(strlen("") + 1); // Initial empty title.
-  if (g->title == NULL) {
-    fprintf(stderr, "Memory allocation failed for initial title.\n");
-    free(g->nodes);
-    free(g->edges);
-    free(g);
+  g->arena = arena_create();
+  g->strings = g->arena != NULL ? create_interner(g->arena) : NULL;
+  g->node_index = create_table();
+  g->title = g->strings != NULL ? intern(g->strings, "", 0) : NULL; // Initial empty title.
+  g->errors = stderr;
+  if (g->arena == NULL || g->strings == NULL || g->node_index == NULL || g->title == NULL ||
+      !resize_graph(g, 4)) { // Initial capacity
+    fprintf(stderr, "Memory allocation failed for graph.\n");
+    free_graph(g);
     return NULL;
   }
-  strcpy(g->title, "");
-
-  g->highest_level = 0;
-  g->nodes_at_level = NULL;
-  g->max_nodes_at_level = 0;
-
-  for (int i = 0; i < g->capacity; i++) {
-    g->edges[i] = calloc(g->capacity, sizeof(int));
-  }
 
   return g;
 }
 
 void free_graph(graph_t* g) {
-  // If no nodes or edges can just free the graph and title
-  if (g->nodes == NULL || g->edges == NULL) {
-    free(g->title);
-    free(g);
+  if (g == NULL) {
     return;
   }
-
-  for (int i = 0; i < g->num_nodes; i++) {
-    free(g->nodes[i]->name);
-    free(g->nodes[i]);
-    free(g->edges[i]);
+  if (g->mapping != NULL) {
+    free_graph_binary(g);
+    return;
+  }
+  if (g->node_index != NULL) {
+    free_table(g->node_index);
   }
 
-  free(g->title);
-  free(g->nodes);
-  free(g->edges);
-  if (g->nodes_at_level != NULL) {
-    free(g->nodes_at_level);
+  if (g->adjacency != NULL) {
+    for (int i = 0; i < g->num_nodes; i++) {
+      free(g->adjacency[i].targets);
+    }
+    free(g->adjacency);
   }
+
+  // Node attributes and strings all live in the arena.
+  free_interner(g->strings);
+  arena_free(g->arena);
+  free(g->edge_offsets);
+  free(g->edge_targets);
+  free(g->edge_bend_offsets);
+  free(g->edge_bends);
+  free(g->nodes_at_level);
   free(g);
 }
 
-static void resize_graph(graph_t* g) {
-  int new_capacity = g->capacity * 2; // Increase capacity by 2.
-  g->nodes = realloc(g->nodes, sizeof(node_t*) * new_capacity);
-  g->edges = realloc(g->edges, sizeof(int*) * new_capacity);
+// Helper to take the next count elements of size bytes from a block being carved into arrays.
+static void* carve(unsigned char** cursor, int count, size_t size) {
+  void* array = *cursor;
+  *cursor += (size_t)count * size;
+  return array;
+}
 
-  for (int i = g->capacity; i < new_capacity; i++) {
-    g->edges[i] = calloc(new_capacity, sizeof(int));
+// Moves the node attribute arrays into one arena block for new_capacity nodes. (the old block stays in the
+// arena, doubling keeps that under the final size) Returns false if memory allocation failed.
+static bool resize_graph(graph_t* g, int new_capacity) {
+  // Widest types first, so every array stays aligned.
+  size_t size = (size_t)new_capacity * (2 * sizeof(double) + 2 * sizeof(const char*) + 5 * sizeof(int));
+  unsigned char* cursor = arena_alloc(g->arena, size);
+  edge_list_t* adjacency = realloc(g->adjacency, sizeof(edge_list_t) * new_capacity);
+  if (cursor == NULL || adjacency == NULL) {
+    if (adjacency != NULL) {
+      g->adjacency = adjacency;
+    }
+    return false;
   }
 
-  for (int i = 0; i < g->capacity; i++) {
-    g->edges[i] = realloc(g->edges[i], sizeof(int) * new_capacity);
-    memset(g->edges[i] + g->capacity, 0, sizeof(int) * (new_capacity - g->capacity));
+  double* x = carve(&cursor, new_capacity, sizeof(double));
+  double* y = carve(&cursor, new_capacity, sizeof(double));
+  const char** names = carve(&cursor, new_capacity, sizeof(const char*));
+  const char** texts = carve(&cursor, new_capacity, sizeof(const char*));
+  int* levels = carve(&cursor, new_capacity, sizeof(int));
+  int* parents = carve(&cursor, new_capacity, sizeof(int));
+  int* num_children = carve(&cursor, new_capacity, sizeof(int));
+  int* component_parent = carve(&cursor, new_capacity, sizeof(int));
+  int* component_size = carve(&cursor, new_capacity, sizeof(int));
+  int n = g->num_nodes;
+  if (n > 0) {
+    memcpy(x, g->x, sizeof(double) * n);
+    memcpy(y, g->y, sizeof(double) * n);
+    memcpy(names, g->names, sizeof(const char*) * n);
+    memcpy(texts, g->texts, sizeof(const char*) * n);
+    memcpy(levels, g->levels, sizeof(int) * n);
+    memcpy(parents, g->parents, sizeof(int) * n);
+    memcpy(num_children, g->num_children, sizeof(int) * n);
+    memcpy(component_parent, g->component_parent, sizeof(int) * n);
+    memcpy(component_size, g->component_size, sizeof(int) * n);
   }
+  g->x = x;
+  g->y = y;
+  g->names = names;
+  g->texts = texts;
+  g->levels = levels;
+  g->parents = parents;
+  g->num_children = num_children;
+  g->component_parent = component_parent;
+  g->component_size = component_size;
+
+  // New nodes start without edges.
+  g->adjacency = adjacency;
+  memset(g->adjacency + g->capacity, 0, sizeof(edge_list_t) * (new_capacity - g->capacity));
 
   g->capacity = new_capacity;
+  return true;
 }
 
-node_t* add_node(graph_t* g, const char* name, const char* text) {
+int add_node(graph_t* g, const char* name, const char* text) {
   // Resize if needed.
-  if (g->num_nodes >= g->capacity) {
-    resize_graph(g);
+  if (g->num_nodes >= g->capacity && !resize_graph(g, g->capacity * 2)) {
+    fprintf(g->errors, "Memory allocation failed for node.\n");
+    return -1;
   }
 
-  // Create node.
-  node_t* node = create_node(name, text);
-  node->id = g->num_nodes;
-
-  // Add node to respective index;
-  g->nodes[g->num_nodes] = node;
+  int id = g->num_nodes;
+  g->names[id] = intern(g->strings, name, strlen(name));
+  g->texts[id] = intern(g->strings, text, strlen(text));
+  if (g->names[id] == NULL || g->texts[id] == NULL) {
+    fprintf(g->errors, "Memory allocation failed for node.\n");
+    return -1;
+  }
+  g->x[id] = -1.0;
+  g->y[id] = -1.0;
+  g->levels[id] = -1;
+  g->parents[id] = -1;
+  g->num_children[id] = 0;
+  // Starts out as its own component.
+  g->component_parent[id] = id;
+  g->component_size[id] = 1;
+  g->num_components++;
   g->num_nodes++;
+  // And make it findable by name. (ids are stored off by one, since NULL means not found)
+  table_set(g->node_index, g->names[id], (void*)(intptr_t)(id + 1));
 
-  return node;
+  return id;
 }
 
-// Return node in graph that has the specified name.
+// Changes node's text.
+bool set_node_text(graph_t* g, int node, const char* text) {
+  const char* interned = intern(g->strings, text, strlen(text));
+  if (interned == NULL) {
+    fprintf(g->errors, "Memory allocation failed for node text.\n");
+    return false;
+  }
+  g->texts[node] = interned;
+  return true;
+}
+
+// Return id of the node in graph that has the specified name.
 // (Parser prohibits same nodes with same name)
-node_t* get_node(graph_t* g, const char* name) {
-  for (int i = 0; i < g->num_nodes; i++) {
-    if (strcmp(g->nodes[i]->name, name) == 0) {
-      return g->nodes[i];
-    }
+int get_node(graph_t* g, const char* name) {
+  return (int)(intptr_t)table_get(g->node_index, name) - 1;
+}
+
+// Return id of the node in graph named by the first length chars of name. (e.g. a token that isn't null terminated)
+int get_node_n(graph_t* g, const char* name, size_t length) {
+  return (int)(intptr_t)table_get_n(g->node_index, name, length) - 1;
+}
+
+// Follows component parents up to the representative, halving the path on the way.
+int find_component(graph_t* g, int node_id) {
+  while (g->component_parent[node_id] != node_id) {
+    g->component_parent[node_id] = g->component_parent[g->component_parent[node_id]];
+    node_id = g->component_parent[node_id];
+  }
+  return node_id;
+}
+
+// Helper to merge the components of nodes a and b, hanging the smaller one under the larger.
+static void union_components(graph_t* g, int a, int b) {
+  a = find_component(g, a);
+  b = find_component(g, b);
+  if (a == b) {
+    return;
+  }
+  if (g->component_size[a] < g->component_size[b]) {
+    int swap = a;
+    a = b;
+    b = swap;
   }
-  return NULL;
+  g->component_parent[b] = a;
+  g->component_size[a] += g->component_size[b];
+  g->num_components--;
 }
 
-// Add edge to edges matrix, using the from node's name and the to node's name.
+// Add edge to the from node's adjacency list, using the from node's name and the to node's name.
 bool add_edge(graph_t* g, const char* from_name, const char* to_name) {
-  node_t* from_node = get_node(g, from_name);
-  node_t* to_node = get_node(g, to_name);
+  return add_edge_ids(g, get_node(g, from_name), get_node(g, to_name));
+}
 
-  // Early return if nodes aren't in graph.
-  if (from_node == NULL || to_node == NULL) {
+bool add_edge_ids(graph_t* g, int from, int to) {
+  // Early return if nodes aren't in graph, or the edges were already frozen.
+  if (from < 0 || to < 0 || from >= g->num_nodes || to >= g->num_nodes || g->adjacency == NULL) {
     return false;
   }
 
+  edge_list_t* list = &g->adjacency[from];
+
   // If edge already exists.
-  if (g->edges[from_node->id][to_node->id] == 1) {
-    return true;
+  for (int i = 0; i < list->count; i++) {
+    if (list->targets[i] == to) {
+      return true;
+    }
   }
 
-  g->edges[from_node->id][to_node->id] = 1;
+  // Grow list if needed.
+  if (list->count >= list->capacity) {
+    int new_capacity = list->capacity == 0 ? 4 : list->capacity * 2;
+    int* targets = realloc(list->targets, sizeof(int) * new_capacity);
+    if (targets == NULL) {
+      fprintf(g->errors, "Memory allocation failed for edge.\n");
+      return false;
+    }
+    list->targets = targets;
+    list->capacity = new_capacity;
+  }
 
-  // Setup node levels...
-  
-  // This is a check and should only run for the root node of the graph
-  if (from_node->level == -1) {
-    from_node->level = 1;
+  list->targets[list->count++] = to;
+  g->num_edges++;
+  union_components(g, from, to);
+
+  return true;
+}
+
+// Helper to order target ids when freezing edges.
+static int compare_ids(const void* a, const void* b) {
+  int x = *(const int*)a;
+  int y = *(const int*)b;
+  return (x > y) - (x < y);
+}
+
+// Packs every node's adjacency list into one array, so edges can be walked without the per-node allocations.
+// Rows are sorted by target id to keep the same edge order as the old adjacency matrix.
+bool freeze_edges(graph_t* g) {
+  if (g->adjacency == NULL) {
+    return true; // Already frozen.
   }
-  // If to_node's level hasn't been initialized it means that it is a direct child.
-  // (i.e. initialize with parent's level + 1)
-  if (to_node->level == -1) {
-    to_node->level = from_node->level + 1;
-    if (to_node->level > g->highest_level) {
-      g->highest_level = to_node->level; // Update graph's highest_level.
+
+  g->edge_offsets = malloc(sizeof(int) * (g->num_nodes + 1));
+  g->edge_targets = malloc(sizeof(int) * (g->num_edges > 0 ? g->num_edges : 1));
+  if (g->edge_offsets == NULL || g->edge_targets == NULL) {
+    fprintf(g->errors, "Memory allocation failed for graph edges.\n");
+    free(g->edge_offsets);
+    free(g->edge_targets);
+    g->edge_offsets = NULL;
+    g->edge_targets = NULL;
+    return false;
+  }
+
+  int offset = 0;
+  for (int i = 0; i < g->num_nodes; i++) {
+    edge_list_t* list = &g->adjacency[i];
+    g->edge_offsets[i] = offset;
+    if (list->count > 0) {
+      memcpy(g->edge_targets + offset, list->targets, sizeof(int) * list->count);
+      qsort(g->edge_targets + offset, list->count, sizeof(int), compare_ids);
+      offset += list->count;
     }
+    free(list->targets);
   }
+  g->edge_offsets[g->num_nodes] = offset;
 
-  // Direct child check.
-  if (to_node->level - from_node->level == 1) {
-    from_node->num_children++;
-    to_node->parent = from_node;
+  free(g->adjacency);
+  g->adjacency = NULL;
+  return true;
+}
+
+// Helper to print a cycle of a graph with back edges (see assign_levels).
+// Nodes that aren't done after taking away roots over and over are each on or below a cycle, so following their
+// incoming edges from other such nodes backwards from the first one has to run into itself.
+static bool report_cycle(graph_t* g) {
+  int n = g->num_nodes;
+  int* in_offsets = calloc(n + 1, sizeof(int));
+  int* in_sources = malloc(sizeof(int) * (g->num_edges > 0 ? g->num_edges : 1));
+  int* path_index = malloc(sizeof(int) * n);
+  int* path = malloc(sizeof(int) * n);
+  int* in_degree = calloc(n, sizeof(int));
+  bool* done = calloc(n, sizeof(bool));
+  if (in_offsets == NULL || in_sources == NULL || path_index == NULL || path == NULL || in_degree == NULL ||
+      done == NULL) {
+    fprintf(g->errors, "Memory allocation failed for cycle report.\n");
+    free(in_offsets);
+    free(in_sources);
+    free(path_index);
+    free(path);
+    free(in_degree);
+    free(done);
+    return false;
+  }
+
+  // Take away roots until only cycles and what is below them are left. (path as the queue)
+  for (int e = 0; e < g->num_edges; e++) {
+    in_degree[g->edge_targets[e]]++;
+  }
+  int head = 0;
+  int tail = 0;
+  for (int i = 0; i < n; i++) {
+    if (in_degree[i] == 0) {
+      done[i] = true;
+      path[tail++] = i;
+    }
+  }
+  while (head < tail) {
+    int u = path[head++];
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      if (--in_degree[g->edge_targets[e]] == 0) {
+        done[g->edge_targets[e]] = true;
+        path[tail++] = g->edge_targets[e];
+      }
+    }
+  }
+  int start = 0;
+  while (done[start]) {
+    start++;
+  }
+
+  // Incoming edges (reverse CSR).
+  for (int e = 0; e < g->num_edges; e++) {
+    in_offsets[g->edge_targets[e] + 1]++;
+  }
+  for (int i = 0; i < n; i++) {
+    in_offsets[i + 1] += in_offsets[i];
+    path_index[i] = -1;
+  }
+  for (int u = 0; u < n; u++) {
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      in_sources[in_offsets[g->edge_targets[e]]++] = u;
+    }
+  }
+  for (int i = n; i > 0; i--) {
+    in_offsets[i] = in_offsets[i - 1];
+  }
+  in_offsets[0] = 0;
+
+  int length = 0;
+  int v = start;
+  while (path_index[v] == -1) {
+    path_index[v] = length;
+    path[length++] = v;
+    for (int e = in_offsets[v]; e < in_offsets[v + 1]; e++) {
+      if (!done[in_sources[e]]) {
+        v = in_sources[e];
+        break;
+      }
+    }
+  }
+
+  // path holds the cycle backwards from path_index[v], print it in edge direction.
+  fprintf(g->errors, "Warning: cycle found: %s", g->names[v]);
+  for (int i = length - 1; i >= path_index[v]; i--) {
+    fprintf(g->errors, " -> %s", g->names[path[i]]);
+  }
+  fprintf(g->errors, "\n");
+
+  free(in_offsets);
+  free(in_sources);
+  free(path_index);
+  free(path);
+  free(in_degree);
+  free(done);
+  return true;
+}
+
+// Sets every node's level, parent and num_children, and the graph's highest_level and nodes_at_level.
+// Kahn's algorithm from all roots (nodes without incoming edges) in O(V + E): a node's level is one more than
+// its deepest parent's, and its parent is the first node that put it there. When only cycles are left the
+// first remaining node (by id) is taken as if its remaining incoming edges pointed back up, and those edges are
+// counted in back_edges. Only the tree layout follows levels, so it is the one that reports cycles. (layout_graph)
+bool assign_levels(graph_t* g) {
+  if (!freeze_edges(g)) {
+    return false;
+  }
+
+  int n = g->num_nodes;
+  int* in_degree = calloc(n > 0 ? n : 1, sizeof(int));
+  int* queue = malloc(sizeof(int) * (n > 0 ? n : 1));
+  bool* done = calloc(n > 0 ? n : 1, sizeof(bool));
+  if (in_degree == NULL || queue == NULL || done == NULL) {
+    fprintf(g->errors, "Memory allocation failed for node levels.\n");
+    free(in_degree);
+    free(queue);
+    free(done);
+    return false;
+  }
+
+  for (int i = 0; i < n; i++) {
+    g->levels[i] = -1;
+    g->parents[i] = -1;
+    g->num_children[i] = 0;
+  }
+  for (int e = 0; e < g->num_edges; e++) {
+    in_degree[g->edge_targets[e]]++;
+  }
+
+  int head = 0;
+  int tail = 0;
+  for (int i = 0; i < n; i++) {
+    if (in_degree[i] == 0) {
+      g->levels[i] = 1;
+      done[i] = true;
+      queue[tail++] = i;
+    }
+  }
+
+  int next_unplaced = 0; // Nodes below this id are all done.
+  g->back_edges = 0;
+  g->highest_level = 0;
+  while (head < n) {
+    if (head == tail) {
+      // Everything left is on or below a cycle.
+      while (done[next_unplaced]) {
+        next_unplaced++;
+      }
+      int v = next_unplaced;
+      if (g->levels[v] == -1) {
+        g->levels[v] = 1;
+      }
+      done[v] = true;
+      queue[tail++] = v;
+    }
+
+    int u = queue[head++];
+    if (g->levels[u] > g->highest_level) {
+      g->highest_level = g->levels[u];
+    }
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      int v = g->edge_targets[e];
+      if (done[v]) {
+        g->back_edges++; // Points back up a cycle.
+        continue;
+      }
+      if (g->levels[u] + 1 > g->levels[v]) {
+        g->levels[v] = g->levels[u] + 1;
+        g->parents[v] = u;
+      }
+      if (--in_degree[v] == 0) {
+        done[v] = true;
+        queue[tail++] = v;
+      }
+    }
+  }
+  // Children and nodes per level, now that every parent is final.
+  free(g->nodes_at_level);
+  g->nodes_at_level = calloc(g->highest_level + 1, sizeof(int));
+  if (g->nodes_at_level == NULL) {
+    fprintf(g->errors, "Memory allocation failed for node levels.\n");
+    free(in_degree);
+    free(queue);
+    free(done);
+    return false;
+  }
+  g->max_nodes_at_level = 0;
+  for (int i = 0; i < n; i++) {
+    if (g->parents[i] != -1) {
+      g->num_children[g->parents[i]]++;
+    }
+    if (++g->nodes_at_level[g->levels[i]] > g->max_nodes_at_level) {
+      g->max_nodes_at_level = g->nodes_at_level[g->levels[i]];
+    }
   }
 
+  free(in_degree);
+  free(queue);
+  free(done);
   return true;
 }
 
 // Prints the layout of the overall graph.
 // (Title, levels, nodes, and their edges)
 void print_graph(graph_t* g) {
+  if (!freeze_edges(g)) {
+    return;
+  }
+
   if (g->title)
     printf("---%s---(%d levels)\n", g->title, g->highest_level);
   for (int from = 0; from < g->num_nodes; from++) {
-    for (int to = 0; to < g->num_nodes; to++) {
-      if (g->edges[from][to]) {
-        printf("%s(%s) - level %d - %d children -> %s(%s) - level %d - %d children\n",
-               g->nodes[from]->name, g->nodes[from]->text, g->nodes[from]->level, g->nodes[from]->num_children,
-               g->nodes[to]->name, g->nodes[to]->text, g->nodes[to]->level, g->nodes[to]->num_children);
-      }
+    for (int e = g->edge_offsets[from]; e < g->edge_offsets[from + 1]; e++) {
+      int to = g->edge_targets[e];
+      printf("%s(%s) - level %d - %d children -> %s(%s) - level %d - %d children\n",
+             g->names[from], g->texts[from], g->levels[from], g->num_children[from],
+             g->names[to], g->texts[to], g->levels[to], g->num_children[to]);
     }
   }
 }
 
 // Update's graph's title.
 void update_graph_title(graph_t* g, const char* title) {
-  if (g->title != NULL) {
-    free(g->title);
+  const char* interned = intern(g->strings, title, strlen(title));
+  if (interned == NULL) {
+    fprintf(g->errors, "Memory allocation failed for graph title.\n");
+    return;
   }
 
-  g->title = malloc(strlen(title) + 1);
-  if (g->title == NULL) {
-    fprintf(stderr, "Memory allocation failed for graph title.\n");
-    return;
+  g->title = interned;
+}
+
+// Helper to check that color is a plain css value (a name, hex or rgb(...) and the like), which is written into the
+// style sheet and attributes as is. Anything that could end the declaration, rule, attribute or element is refused.
+static bool valid_svg_color(const char* color) {
+  if (*color == '\0') {
+    return false;
+  }
+  for (const char* c = color; *c != '\0'; c++) {
+    if (!isalnum((unsigned char)*c) && strchr("#(),.% +-/", *c) == NULL) {
+      return false;
+    }
   }
+  return strstr(color, "/*") == NULL;
+}
 
-  strcpy(g->title, title);
+// Helper to write the style classes shared by the graph's nodes, edges, and text.
+// Returns false (after printing why) if memory allocation failed.
+static bool write_graph_style(svg_t* svg, char* node_color, int text_size, FILE* errors) {
+  const char* format =
+    "    .node { fill: %s; stroke: black; stroke-width: 6px; }\n"
+    "    .edge { fill: none; stroke: black; stroke-width: 8px; stroke-linejoin: bevel; }\n"
+    "    .label, .title { font-family: sans-serif; fill: black; stroke: black; text-anchor: middle; dominant-baseline: middle; }\n"
+    "    .label { font-size: %dpx; }\n"
+    "    .title { font-size: %dpx; }\n";
+  int title_size = text_size * 1.5;
+
+  int length = snprintf(NULL, 0, format, node_color, text_size, title_size);
+  char* css = malloc(length + 1);
+  if (css == NULL) {
+    fprintf(errors, "Memory allocation failed for svg style\n");
+    return false;
+  }
+  snprintf(css, length + 1, format, node_color, text_size, title_size);
+
+  svg_style(svg, css);
+  free(css);
+  return true;
 }
 
-// Helper function to calculate each node's required width (x-space) for drawing the graph.
-static void calculate_required_widths(graph_t* g) {
-  const int PADDING = RECT_WIDTH * 0.10;
+// Helper to find where an edge's arrow should stop.
+// If it was just a line it would be a simple Point A (from_node's pos) to Point B (to_node's pos)
+// but arrow's make it more complicated...
+// (from_x, from_y) is where the edge's last segment starts, the from node or its last bend.
+static void edge_end_point(double from_x, double from_y, double to_x, double to_y, double* x, double* y) {
+  // Find direction of edge so we know where to stop on the node so we don't go inside and can see the arrowhead.
+  enum DIRECTION { DOWN, UP, LEFT, RIGHT };
+  enum DIRECTION direction = DOWN;
+  if (to_y == from_y && to_x < from_x)
+    direction = LEFT;
+  else if (to_y == from_y && to_x > from_x)
+    direction = RIGHT;
+  if (to_y > from_y)
+    direction = DOWN;
+  else if (to_y < from_y)
+    direction = UP;
+
+  *x = to_x;
+  *y = to_y;
+  switch (direction) {
+    case DOWN:
+      *y -= RECT_HEIGHT / 2; // Stop at the top side of the node.
+      break;
+    case UP:
+      *y += RECT_HEIGHT / 2; // Stop at the bottom side of the node.
+      break;
+    case LEFT:
+      *x += RECT_WIDTH / 2; // Stop at the right side of the node.
+      break;
+    case RIGHT:
+      *x -= RECT_WIDTH / 2; // Stop at the left side of the node.
+      break;
+  }
+}
 
-  // Initialize required widths
-  for (int i = 0; i < g->num_nodes; i++) {
-    g->nodes[i]->required_width = RECT_WIDTH + PADDING;
+// Helper to get the range of edge e's bends, empty for straight edges.
+static void edge_bend_range(graph_t* g, int e, int* first, int* last) {
+  if (g->edge_bend_offsets == NULL) {
+    *first = *last = 0;
+    return;
   }
+  *first = g->edge_bend_offsets[e];
+  *last = g->edge_bend_offsets[e + 1];
+}
 
-  // Traverse from the bottom level to the top
-  for (int level = g->highest_level; level >= 0; level--) {
-    for (int i = 0; i < g->num_nodes; i++) {
-      if (g->nodes[i]->level == level) {
-        node_t* parent_node = g->nodes[i];
-        double total_child_width = 0;
-
-        for (int j = 0; j < g->num_nodes; j++) {
-          if (g->edges[parent_node->id][j]) {
-            if (g->nodes[j]->level - parent_node->level == 1) // Only add width of its direct children, not all edges.
-              total_child_width += g->nodes[j]->required_width;
-          }
-        }
-
-        if (total_child_width > parent_node->required_width) {
-          parent_node->required_width = total_child_width;
-        }
-      }
+// Helper to get the y position of the graph's title. (above the topmost node)
+static int title_y(graph_t* g, int height) {
+  if (g->num_nodes == 0) {
+    return height / 10;
+  }
+  double top = g->y[0];
+  for (int i = 1; i < g->num_nodes; i++) {
+    if (g->y[i] < top) {
+      top = g->y[i];
     }
   }
+  return top - RECT_HEIGHT / 1.2;
 }
 
-// Function to draw the entirety of the graph.
-void draw_graph(graph_t* g, char* bg_color, char* node_color, int text_size) {
-  // Get important width requirements.
-  calculate_required_widths(g);
+// Helper to write the graph as svg (streamed straight to the file) to filename. Returns false if it couldn't.
+static bool draw_svg(graph_t* g, draw_options_t* options, int width, int height, const char* filename) {
+  const char* colors[] = { options->node_color, options->bg_color };
+  for (int i = 0; i < 2; i++) {
+    if (!valid_svg_color(colors[i])) {
+      fprintf(g->errors, "Invalid color \"%s\", expected a color name, hex or rgb value.\n", colors[i]);
+      return false;
+    }
+  }
 
-  // Graph constants. (subject to change)
-  const int GRAPH_PADDING = 400;
-  const int WIDTH = g->nodes[0]->required_width + GRAPH_PADDING;
-  const int HEIGHT = RECT_HEIGHT * g->num_nodes + GRAPH_PADDING;
+  // Open the output file up front so the svg is streamed to it while drawing.
+  FILE* fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    fprintf(g->errors, "Could not open output file \"%s\".\n", filename);
+    return false;
+  }
 
   // Initialize svg.
-  svg_t* svg = svg_create(WIDTH, HEIGHT);
+  svg_t* svg;
+  if (options->compress_level >= 0) {
+    svg = svg_create_compressed_stream(width, height, fp, options->compress_level);
+  } else {
+    svg = svg_create_stream(width, height, fp);
+  }
+  if (svg == NULL) {
+    fprintf(g->errors, "Memory allocation failed for svg\n");
+    fclose(fp);
+    return false;
+  }
+  // Shared styles so each element only has to carry its geometry.
+  if (!write_graph_style(svg, options->node_color, options->text_size, g->errors)) {
+    svg_free(svg);
+    fclose(fp);
+    return false;
+  }
   // Fill background.
-  svg_fill(svg, bg_color);
+  svg_fill(svg, options->bg_color);
 
-  // Calculate and store positions of all nodes.
-  for (int level = g->highest_level; level >= 0; level--) {
-    double used_up_width = 0.0; // Used for x-offset if there were previous nodes on level.
-    for (int i = 0; i < g->num_nodes; i++) {
-      if (g->nodes[i]->level == level) {
-        node_t* current_node = g->nodes[i];
-        // Offset from previous used_up_width and center according to: its required width, the graph's width, and the root node's required width.
-        current_node->x_pos = (used_up_width + current_node->required_width / 2) + WIDTH / 2 - g->nodes[0]->required_width / 2;
-        // Place depending on its level in the graph and the graph's height.
-        current_node->y_pos = ((double)level / (double)(g->highest_level + 1)) * HEIGHT;
-        used_up_width += current_node->required_width; // The node's width is now used up.
+  // Draw title.
+  svg_text_class(svg, "title", width / 2, title_y(g, height), g->title);
+
+  // Draw all edges first. (batched into a single path)
+  svg_path_begin(svg, "edge");
+  for (int from = 0; from < g->num_nodes; from++) {
+    for (int e = g->edge_offsets[from]; e < g->edge_offsets[from + 1]; e++) {
+      double x1 = g->x[from];
+      double y1 = g->y[from];
+      int first, last;
+      edge_bend_range(g, e, &first, &last);
+      if (first == last) {
+        double x, y;
+        edge_end_point(x1, y1, g->x[g->edge_targets[e]], g->y[g->edge_targets[e]], &x, &y);
+        svg_path_arrow(svg, RECT_WIDTH / 10, x1, y1, x, y);
+        continue;
+      }
+
+      // Bent edges are one polyline, with the arrowhead on its last segment.
+      svg_path_line(svg, x1, y1, g->edge_bends[first].x, g->edge_bends[first].y);
+      for (int b = first + 1; b < last; b++) {
+        svg_path_line_to(svg, g->edge_bends[b].x, g->edge_bends[b].y);
       }
+      point_t bend = g->edge_bends[last - 1];
+      double x, y;
+      edge_end_point(bend.x, bend.y, g->x[g->edge_targets[e]], g->y[g->edge_targets[e]], &x, &y);
+      svg_path_line_to(svg, x, y);
+      svg_path_arrowhead(svg, RECT_WIDTH / 10, bend.x, bend.y, x, y);
     }
   }
+  svg_path_end(svg);
 
-  // Draw title.
-  svg_text(svg, WIDTH / 2, g->num_nodes > 0 ? g->nodes[0]->y_pos - RECT_HEIGHT / 1.2 : HEIGHT / 10, "sans-serif", text_size * 1.5, "black", "black", g->title);
-
-  // Adjust the positions of child nodes based on their parent's position
+  // Draw all nodes on top of edges.
   for (int i = 0; i < g->num_nodes; i++) {
-    node_t* current_node = g->nodes[i];
-    node_t* parent_node = current_node->parent;
-    if (parent_node == NULL) {
-      continue; // Skip if the current node does not have a parent
-    }
+    double x = g->x[i];
+    double y = g->y[i];
 
-    // Calculate the total number of children for the parent
-    double total_children_width = 0.0;
-    for (int j = 0; j < g->num_nodes; j++) {
-      if (g->nodes[j]->parent == parent_node) {
-        total_children_width += g->nodes[j]->required_width;
-      }
-    }
+    // Draw rectangles centered on the nodes' positions.
+    svg_rectangle_class(svg, "node", RECT_WIDTH, RECT_HEIGHT, x - (RECT_WIDTH / 2), y - (RECT_HEIGHT / 2), 8, 8);
+    // Draw the nodes' text on top.
+    svg_text_class(svg, "label", x, y, g->texts[i]);
+  }
 
-    // Calculate the starting position (leftmost position) for the children
-    double start_x = parent_node->x_pos - (total_children_width / 2);
+  // Finally, finish writing the svg and clean up.
+  svg_save(svg);
+  svg_free(svg);
+  bool written = !ferror(fp);
+  if (fclose(fp) != 0 || !written) {
+    fprintf(g->errors, "Could not write output file \"%s\".\n", filename);
+    return false;
+  }
+  return true;
+}
 
-    // Position each child based on its required width
-    double current_x = start_x;
-    for (int j = 0; j < g->num_nodes; j++) {
-      if (g->nodes[j]->parent == parent_node) {
-        g->nodes[j]->x_pos = current_x + g->nodes[j]->required_width / 2;
-        current_x += g->nodes[j]->required_width;
-      }
+// Helper to write the graph as png to filename. Returns false if it couldn't.
+static bool draw_png(graph_t* g, draw_options_t* options, int width, int height, const char* filename) {
+  // Scale huge graphs down so the image stays a sane size, but never so far that the labels can't be read.
+  // Graphs that would still be too big for one image at that scale fail, there's no point in drawing them unreadable.
+  const double MAX_PNG_DIMENSION = 8192;
+  const double MAX_PNG_PIXELS = MAX_PNG_DIMENSION * MAX_PNG_DIMENSION;
+  double scale = 1.0;
+  if (width > MAX_PNG_DIMENSION || height > MAX_PNG_DIMENSION) {
+    scale = MAX_PNG_DIMENSION / (width > height ? width : height);
+  }
+  double min_scale = raster_legible_scale(options->text_size);
+  if (scale < min_scale) {
+    scale = min_scale;
+    if (width * scale * height * scale > MAX_PNG_PIXELS) {
+      fprintf(g->errors, "Graph is too large for a png with readable text (%.0f x %.0f px), draw it as svg instead.\n",
+              ceil(width * scale), ceil(height * scale));
+      return false;
     }
   }
 
-  // Draw all edges first.
+  raster_t* raster = raster_create(width, height, scale);
+  if (raster == NULL) {
+    fprintf(g->errors, "Memory allocation failed for png\n");
+    return false;
+  }
+  raster_fill(raster, options->bg_color);
+
+  // Same drawing as the svg.
+  raster_text(raster, width / 2, title_y(g, height), "sans-serif", options->text_size * 1.5, "black", "black", g->title);
+
   for (int from = 0; from < g->num_nodes; from++) {
-    for (int to = 0; to < g->num_nodes; to++) {
-      if (g->edges[from][to]) {
-        // If it was just a line it would be a simple Point A (from_node's pos) to Point B (to_node's pos)
-        // but arrow's make it more complicated...
-        node_t* from_node = g->nodes[from];
-        node_t* to_node = g->nodes[to];
-
-        // Find direction of edge so we know where to stop on the node so we don't go inside and can see the arrowhead.
-        enum DIRECTION { DOWN, UP, LEFT, RIGHT };
-        enum DIRECTION direction;
-        if (to_node->y_pos == from_node->y_pos && to_node->x_pos < from_node->x_pos)
-          direction = LEFT;
-        else if (to_node->y_pos == from_node->y_pos && to_node->x_pos > from_node->x_pos)
-          direction = RIGHT;
-        if (to_node->y_pos > from_node->y_pos)
-          direction = DOWN;
-        else if (to_node->y_pos < from_node->y_pos)
-          direction = UP;
-
-        switch (direction) {
-          case DOWN: {
-            // Stop at the top side of the node.
-            svg_arrow(svg, "black", 8, RECT_WIDTH / 10, from_node->x_pos, from_node->y_pos,
-                     to_node->x_pos, to_node->y_pos - RECT_HEIGHT / 2);
-            break;
-          }
-          case UP: {
-            // Stop at the bottom side of the node.
-            svg_arrow(svg, "black", 8, RECT_WIDTH / 10, from_node->x_pos, from_node->y_pos,
-                     to_node->x_pos, to_node->y_pos + RECT_HEIGHT / 2);
-            break;
-          }
-          case LEFT: {
-            // Stop at the right side of the node.
-            svg_arrow(svg, "black", 8, RECT_WIDTH / 10, from_node->x_pos, from_node->y_pos,
-                     to_node->x_pos + RECT_WIDTH / 2, to_node->y_pos);
-            break;
-          }
-          case RIGHT: {
-            // Stop at the left side of the node.
-            svg_arrow(svg, "black", 8, RECT_WIDTH / 10, from_node->x_pos, from_node->y_pos,
-                     to_node->x_pos - RECT_WIDTH / 2, to_node->y_pos);
-            break;
-          }
-        }
+    for (int e = g->edge_offsets[from]; e < g->edge_offsets[from + 1]; e++) {
+      double x1 = g->x[from];
+      double y1 = g->y[from];
+      int first, last;
+      edge_bend_range(g, e, &first, &last);
+      for (int b = first; b < last; b++) {
+        raster_line(raster, "black", 8, x1, y1, g->edge_bends[b].x, g->edge_bends[b].y);
+        x1 = g->edge_bends[b].x;
+        y1 = g->edge_bends[b].y;
       }
+      double x, y;
+      edge_end_point(x1, y1, g->x[g->edge_targets[e]], g->y[g->edge_targets[e]], &x, &y);
+      raster_arrow(raster, "black", 8, RECT_WIDTH / 10, x1, y1, x, y);
     }
   }
 
-  // Draw all nodes on top of edges.
   for (int i = 0; i < g->num_nodes; i++) {
-    node_t* curr_node = g->nodes[i];
-    double x = curr_node->x_pos;
-    double y = curr_node->y_pos;
+    double x = g->x[i];
+    double y = g->y[i];
 
-    // Draw rectangles centered on the nodes' positions.
-    svg_rectangle(svg, RECT_WIDTH, RECT_HEIGHT, x - (RECT_WIDTH / 2), y - (RECT_HEIGHT / 2), node_color, "black", 6, 8, 8);
-    // Draw the nodes' text on top.
-    svg_text(svg, x, y, "sans-serif", text_size, "black", "black", curr_node->text);
+    raster_rectangle(raster, RECT_WIDTH, RECT_HEIGHT, x - (RECT_WIDTH / 2), y - (RECT_HEIGHT / 2), options->node_color, "black", 6, 8, 8);
+    raster_text(raster, x, y, "sans-serif", options->text_size, "black", "black", g->texts[i]);
   }
 
+  int level = options->compress_level >= 0 ? options->compress_level : DEFLATE_DEFAULT_LEVEL;
+  bool written = raster_save_png(raster, filename, level);
+  if (!written) {
+    fprintf(g->errors, "Could not write output file \"%s\".\n", filename);
+  }
+  raster_free(raster);
+  return written;
+}
+
+// Helper to lay out a graph (or one of its components) with the layout picked in options.
+static bool layout_with_options(graph_t* g, void* context) {
+  draw_options_t* options = context;
+  const int PADDING = RECT_WIDTH * 0.10;
+  switch (options->layout) {
+    case LAYOUT_LAYERED:
+      return layout_layered(g, RECT_WIDTH + PADDING, RECT_HEIGHT * 2, options->pool);
+    case LAYOUT_FORCE:
+      return layout_force(g, (RECT_WIDTH + PADDING) * 1.5, options->pool);
+    default:
+      return layout_tree(g, RECT_WIDTH + PADDING, RECT_HEIGHT * 2);
+  }
+}
+
+bool layout_graph(graph_t* g, draw_options_t* options) {
+  // Layout only walks edges, so pack them first.
+  if (!freeze_edges(g)) {
+    return false;
+  }
+
+  // The tree layout places nodes by level, which doesn't follow edges pointing back up cycles. (the other layouts
+  // handle cycles on their own)
+  if (options->layout == LAYOUT_TREE && g->back_edges > 0) {
+    if (!report_cycle(g)) {
+      return false;
+    }
+    fprintf(g->errors, "Warning: %d edge%s closing cycles %s not used for node levels in the tree layout.\n",
+            g->back_edges, g->back_edges == 1 ? "" : "s", g->back_edges == 1 ? "is" : "are");
+  }
+
+  // Lay each component out on its own, packed together starting at 0.
+  if (!layout_components(g, layout_with_options, options, RECT_WIDTH, RECT_HEIGHT, RECT_WIDTH / 2, options->pool)) {
+    return false;
+  }
+
+  // Graph constants. (subject to change)
+  const int GRAPH_PADDING = 400;
+  double layout_width = 0.0;
+  double layout_height = 0.0;
+  for (int i = 0; i < g->num_nodes; i++) {
+    if (g->x[i] > layout_width) {
+      layout_width = g->x[i];
+    }
+    if (g->y[i] > layout_height) {
+      layout_height = g->y[i];
+    }
+  }
+  int num_bends = g->edge_bend_offsets != NULL ? g->edge_bend_offsets[g->num_edges] : 0;
+  for (int b = 0; b < num_bends; b++) {
+    if (g->edge_bends[b].x > layout_width) {
+      layout_width = g->edge_bends[b].x;
+    }
+  }
+
+  // Center the layout in the drawing, leaving room for the title on top.
+  g->width = layout_width + RECT_WIDTH + GRAPH_PADDING;
+  double x_offset = (RECT_WIDTH + GRAPH_PADDING) / 2;
+  double y_offset = GRAPH_PADDING / 2 + RECT_HEIGHT;
+  g->height = y_offset + layout_height + RECT_HEIGHT / 2 + GRAPH_PADDING / 2;
+  for (int i = 0; i < g->num_nodes; i++) {
+    g->x[i] += x_offset;
+    g->y[i] += y_offset;
+  }
+  for (int b = 0; b < num_bends; b++) {
+    g->edge_bends[b].x += x_offset;
+    g->edge_bends[b].y += y_offset;
+  }
+  return true;
+}
+
+char* graph_filename(graph_t* g, draw_options_t* options) {
   // Get filename from graph's title.
-  char* svg_filename;
-  size_t filename_length;
-  if (strcmp(g->title, "") == 0) {
-    filename_length = strlen("output") + 5;
-  } else {
-    filename_length = strlen(g->title) + 5;
+  const char* extension = options->format == OUTPUT_PNG ? ".png" : options->compress_level >= 0 ? ".svgz" : ".svg";
+  const char* name = strcmp(g->title, "") == 0 ? "output" : g->title;
+  size_t filename_length = strlen(name) + strlen(extension) + 1;
+  char* filename = malloc(filename_length * sizeof(char));
+  if (!filename) {
+    fprintf(g->errors, "Memory allocation failed for filename\n");
+    return NULL;
   }
-  svg_filename = malloc(filename_length * sizeof(char));
-  if (!svg_filename) {
-    fprintf(stderr, "Memory allocation failed for svg_filename\n");
-    return;
+  snprintf(filename, filename_length, "%s%s", name, extension);
+  return filename;
+}
+
+bool render_graph(graph_t* g, draw_options_t* options, const char* path) {
+  if (path != NULL) {
+    return options->format == OUTPUT_PNG ? draw_png(g, options, g->width, g->height, path)
+                                         : draw_svg(g, options, g->width, g->height, path);
   }
 
-  if (strcmp(g->title, "") == 0) {
-    snprintf(svg_filename, filename_length, "output.svg");
-  } else {
-    snprintf(svg_filename, filename_length, "%s.svg", g->title);
+  char* filename = graph_filename(g, options);
+  if (filename == NULL) {
+    return false;
   }
+  bool drawn = render_graph(g, options, filename);
+  free(filename);
+  return drawn;
+}
 
-  // Finally, save and free svg.
-  svg_save(svg, svg_filename);
-  free(svg_filename);
+// Function to draw the entirety of the graph.
+bool draw_graph(graph_t* g, draw_options_t* options, const char* path) {
+  return layout_graph(g, options) && render_graph(g, options, path);
 }
@@ -2,37 +2,137 @@
 #define GRAPH_H
 
 #include <stdbool.h>
-#include "node.h"
+#include <stdio.h>
+#include "table.h"
+#include "arena.h"
+#include "intern.h"
+#include "pool.h"
+
+// Point in the drawing.
+typedef struct {
+  double x;
+  double y;
+} point_t;
+
+// A node's outgoing edges while the graph is being built.
+typedef struct {
+  int* targets; // Ids of the nodes the edges point to.
+  int count;
+  int capacity;
+} edge_list_t;
 
 // Graph type.
 typedef struct {
-  char* title;
-  node_t** nodes;
-  int** edges;
+  const char* title;
+  arena_t* arena; // Node attributes and strings, freed all at once with the graph.
+  interner_t* strings; // Names, texts and the title, each distinct string stored once in the arena.
+  // Node attributes, indexed by node id (structure of arrays, so passes over one attribute stream through
+  // memory). They share one arena block, which is replaced by one twice the size when it fills up.
+  const char** names; // Interned.
+  const char** texts; // Interned.
+  double* x;
+  double* y;
+  int* levels;       // Set by assign_levels, roots are 1.
+  int* parents;      // Set by assign_levels, -1 for nodes without a parent.
+  int* num_children; // Set by assign_levels.
+  table_t* node_index; // Node name -> node id + 1, for lookups by name.
+  edge_list_t* adjacency; // Outgoing edges of each node, until frozen.
+  // Frozen (CSR) edges: node i's targets are edge_targets[edge_offsets[i]] up to edge_targets[edge_offsets[i + 1]].
+  // NULL until freeze_edges is called.
+  int* edge_offsets;
+  int* edge_targets;
+  // Bend points of edges routed around nodes by the layout (NULL if every edge is straight):
+  // edge e's bends are edge_bends[edge_bend_offsets[e]] up to edge_bends[edge_bend_offsets[e + 1]], from -> to.
+  int* edge_bend_offsets;
+  point_t* edge_bends;
+  // Connected components (union-find, ignoring edge direction), kept up to date by add_node and add_edge.
+  // (per node id, in the node attribute block)
+  int* component_parent;
+  int* component_size;
+  int num_components;
   int num_nodes;
+  int num_edges;
   int capacity;
+  // Set by assign_levels.
   int highest_level;
-  int* nodes_at_level;
+  int* nodes_at_level; // Number of nodes on each level, indexed by level. (0 is unused)
   int max_nodes_at_level;
+  int back_edges; // Edges into nodes already on a level, closing cycles. (levels don't follow them)
+  // Size of the drawing, set by layout_graph.
+  int width;
+  int height;
+  FILE* errors; // Where errors and warnings about the graph are printed. (stderr unless changed)
+  // Set when the graph was loaded from a binary file: its arrays point into this mapping of it. (see binary.h)
+  void* mapping;
+  size_t mapping_length;
 } graph_t;
 
+// Output file formats.
+typedef enum {
+  OUTPUT_SVG,
+  OUTPUT_PNG
+} output_format;
+
+// Layout algorithms.
+typedef enum {
+  LAYOUT_TREE,    // Tidy tree of each node's parent/children. (default)
+  LAYOUT_LAYERED, // Layered drawing for graphs that aren't trees.
+  LAYOUT_FORCE    // Force directed drawing for graphs without any hierarchy.
+} layout_mode;
+
+// Options for drawing a graph.
+typedef struct {
+  char* bg_color;
+  char* node_color;
+  int text_size;
+  int compress_level; // gzip level (0-9) to write a .svgz, -1 to write a plain .svg. (png: deflate level, -1 for default)
+  output_format format;
+  layout_mode layout;
+  pool_t* pool; // Threads for layout work, NULL to do it all on the calling thread.
+} draw_options_t;
 
 // Creates and returns initialized graph.
 graph_t* create_graph();
 // Handles freeing memory used by graph.
 void free_graph(graph_t* g);
-// Creates and adds node to graph with name and text.
-node_t* add_node(graph_t* g, const char* name, const char* text);
-// Returns node if found in graph, else NULL.
-node_t* get_node(graph_t* g, const char* name);
+// Adds node to graph with name and text (both interned), returns its id or -1 if memory allocation failed.
+int add_node(graph_t* g, const char* name, const char* text);
+// Changes the text of node (an id), interning text. Returns false if memory allocation failed.
+bool set_node_text(graph_t* g, int node, const char* text);
+// Returns id of the node if found in graph, else -1.
+int get_node(graph_t* g, const char* name);
+// Returns id of the node named by the first length chars of name if found in graph, else -1.
+int get_node_n(graph_t* g, const char* name, size_t length);
 // Prints the layout of the graph.
 void print_graph(graph_t* g);
-// Adds edge to adj matrix of graph between two nodes defined by name.
-// Returns true if edge added, else false.
+// Adds edge to adjacency lists of graph between two nodes defined by name.
+// Returns true if edge added, else false. (also false once edges are frozen)
 bool add_edge(graph_t* g, const char* from_name, const char* to_name);
-// Frees and then changes graph's title.
+// Same as add_edge, between two nodes given by id. (for callers that already know them, skips the name lookups)
+bool add_edge_ids(graph_t* g, int from, int to);
+// Returns the id of the node representing node_id's connected component. (same for every node in it)
+int find_component(graph_t* g, int node_id);
+// Packs the adjacency lists into the CSR arrays, sorted by target id. (does nothing if already frozen)
+// Returns false if memory allocation failed.
+bool freeze_edges(graph_t* g);
+// Sets every node's level (roots are 1), parent and num_children, and the graph's highest_level and
+// nodes_at_level (indexed by level), in one pass over the edges. Freezes the edges first.
+// Cycles are reported on stderr and laid out as if one edge of each pointed back up.
+// Returns false if memory allocation failed.
+bool assign_levels(graph_t* g);
+// Changes graph's title. (interned)
 void update_graph_title(graph_t* g, const char* title);
-// Creates svg drawing of graph.
-void draw_graph(graph_t* graph, char* bg_color, char* node_color, int text_size);
+// Lays out graph with the layout picked in options, setting every node's (and bend's) position in the drawing
+// and the graph's width and height. Returns false if memory allocation failed.
+bool layout_graph(graph_t* graph, draw_options_t* options);
+// Returns the file graph is drawn to when no path is given: "<title>.svg" (".svgz", ".png"), "output.svg" without
+// a title. Returns NULL (after printing why) if memory allocation failed. (the caller frees it)
+char* graph_filename(graph_t* graph, draw_options_t* options);
+// Draws a laid out graph to path, or to "<title>.svg" (".svgz", ".png") in the working directory if path is NULL.
+// Returns false (after printing why) if it couldn't be drawn.
+bool render_graph(graph_t* graph, draw_options_t* options, const char* path);
+// Lays out graph and draws it to path, or to "<title>.svg" (".svgz", ".png") in the working directory if path is NULL.
+// Returns false (after printing why) if it couldn't be drawn.
+bool draw_graph(graph_t* graph, draw_options_t* options, const char* path);
 
 #endif
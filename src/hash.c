@@ -0,0 +1,136 @@
+#include "hash.h"
+#include <string.h>
+
+#define PRIME_1 0x9E3779B185EBCA87ULL
+#define PRIME_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME_3 0x165667B19E3779F9ULL
+#define PRIME_4 0x85EBCA77C2B2AE63ULL
+#define PRIME_5 0x27D4EB2F165667C5ULL
+
+// Helper to rotate x left by bits.
+static uint64_t rotate_left(uint64_t x, int bits) {
+  return (x << bits) | (x >> (64 - bits));
+}
+
+// Helper to read 8 bytes at p, in any alignment. (little endian machines get the reference hashes)
+static uint64_t read_64(const unsigned char* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// Helper to read 4 bytes at p, in any alignment.
+static uint32_t read_32(const unsigned char* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// Helper to mix 8 bytes of input into a lane.
+static uint64_t round_lane(uint64_t lane, uint64_t input) {
+  lane += input * PRIME_2;
+  lane = rotate_left(lane, 31);
+  return lane * PRIME_1;
+}
+
+// Helper to fold a lane into the hash once all of the steps are done.
+static uint64_t merge_lane(uint64_t hash, uint64_t lane) {
+  hash ^= round_lane(0, lane);
+  return hash * PRIME_1 + PRIME_4;
+}
+
+// Helper to run the lanes over every whole 32 byte step of data, returns the bytes used.
+static size_t hash_steps(uint64_t lanes[4], const unsigned char* data, size_t length) {
+  size_t used = 0;
+  for (; used + 32 <= length; used += 32) {
+    lanes[0] = round_lane(lanes[0], read_64(data + used));
+    lanes[1] = round_lane(lanes[1], read_64(data + used + 8));
+    lanes[2] = round_lane(lanes[2], read_64(data + used + 16));
+    lanes[3] = round_lane(lanes[3], read_64(data + used + 24));
+  }
+  return used;
+}
+
+// Helper to finish the hash from the lanes, the bytes left after the last step and the total length.
+static uint64_t hash_finish(const uint64_t lanes[4], uint64_t seed, uint64_t total, const unsigned char* tail,
+                            size_t tail_length) {
+  uint64_t hash;
+  if (total >= 32) {
+    hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) + rotate_left(lanes[2], 12) +
+           rotate_left(lanes[3], 18);
+    for (int i = 0; i < 4; i++) {
+      hash = merge_lane(hash, lanes[i]);
+    }
+  } else {
+    hash = seed + PRIME_5;
+  }
+  hash += total;
+
+  size_t i = 0;
+  for (; i + 8 <= tail_length; i += 8) {
+    hash ^= round_lane(0, read_64(tail + i));
+    hash = rotate_left(hash, 27) * PRIME_1 + PRIME_4;
+  }
+  if (i + 4 <= tail_length) {
+    hash ^= (uint64_t)read_32(tail + i) * PRIME_1;
+    hash = rotate_left(hash, 23) * PRIME_2 + PRIME_3;
+    i += 4;
+  }
+  for (; i < tail_length; i++) {
+    hash ^= tail[i] * PRIME_5;
+    hash = rotate_left(hash, 11) * PRIME_1;
+  }
+
+  // Avalanche, so every input bit affects every output bit.
+  hash ^= hash >> 33;
+  hash *= PRIME_2;
+  hash ^= hash >> 29;
+  hash *= PRIME_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+void hasher_init(hasher_t* hasher, uint64_t seed) {
+  hasher->lanes[0] = seed + PRIME_1 + PRIME_2;
+  hasher->lanes[1] = seed + PRIME_2;
+  hasher->lanes[2] = seed;
+  hasher->lanes[3] = seed - PRIME_1;
+  hasher->seed = seed;
+  hasher->total = 0;
+  hasher->tail_length = 0;
+}
+
+void hasher_update(hasher_t* hasher, const void* data, size_t length) {
+  const unsigned char* bytes = data;
+  hasher->total += length;
+
+  // Finish the step started by earlier data first.
+  if (hasher->tail_length > 0) {
+    size_t needed = sizeof(hasher->tail) - hasher->tail_length;
+    size_t taken = length < needed ? length : needed;
+    memcpy(hasher->tail + hasher->tail_length, bytes, taken);
+    hasher->tail_length += taken;
+    bytes += taken;
+    length -= taken;
+    if (hasher->tail_length < sizeof(hasher->tail)) {
+      return;
+    }
+    hash_steps(hasher->lanes, hasher->tail, sizeof(hasher->tail));
+    hasher->tail_length = 0;
+  }
+
+  size_t used = hash_steps(hasher->lanes, bytes, length);
+  memcpy(hasher->tail, bytes + used, length - used);
+  hasher->tail_length = length - used;
+}
+
+uint64_t hasher_final(hasher_t* hasher) {
+  return hash_finish(hasher->lanes, hasher->seed, hasher->total, hasher->tail, hasher->tail_length);
+}
+
+uint64_t hash_bytes(const void* data, size_t length, uint64_t seed) {
+  hasher_t hasher;
+  hasher_init(&hasher, seed);
+  hasher_update(&hasher, data, length);
+  return hasher_final(&hasher);
+}
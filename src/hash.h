@@ -0,0 +1,26 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns the 64 bit hash of length bytes of data (XXH64, 32 bytes a step), different for every seed.
+uint64_t hash_bytes(const void* data, size_t length, uint64_t seed);
+
+// Hash being built from several pieces of data, the same as hashing them one after another in one piece.
+typedef struct {
+  uint64_t lanes[4];
+  uint64_t seed;
+  uint64_t total;         // Bytes hashed so far.
+  unsigned char tail[32]; // Bytes not yet a whole step.
+  size_t tail_length;
+} hasher_t;
+
+// Starts hasher with seed.
+void hasher_init(hasher_t* hasher, uint64_t seed);
+// Adds length bytes of data to the hash.
+void hasher_update(hasher_t* hasher, const void* data, size_t length);
+// Returns the hash of everything added. (hasher can't be updated anymore)
+uint64_t hasher_final(hasher_t* hasher);
+
+#endif
@@ -0,0 +1,115 @@
+#include "intern.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET 14695981039346656037UL
+#define FNV_PRIME 1099511628211UL
+
+#define INITIAL_CAPACITY 64
+
+// Interned string, the hash and length are kept to skip most string compares.
+typedef struct {
+  const char* text; // NULL for empty slots.
+  uint64_t hash;
+  size_t length;
+} interned_t;
+
+struct interner {
+  arena_t* arena;
+  interned_t* entries;
+  int count;
+  int capacity; // Power of two, kept at most half full.
+};
+
+// Function to hash the first length chars of text. (FNV-1a, same as the table's)
+static uint64_t hash_text(const char* text, size_t length) {
+  uint64_t hash = FNV_OFFSET;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint64_t)(unsigned char)text[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+interner_t* create_interner(arena_t* arena) {
+  interner_t* interner = malloc(sizeof(interner_t));
+  if (interner == NULL) {
+    return NULL;
+  }
+  interner->arena = arena;
+  interner->count = 0;
+  interner->capacity = INITIAL_CAPACITY;
+  interner->entries = calloc(interner->capacity, sizeof(interned_t));
+  if (interner->entries == NULL) {
+    free(interner);
+    return NULL;
+  }
+  return interner;
+}
+
+void free_interner(interner_t* interner) {
+  if (interner == NULL) {
+    return;
+  }
+  free(interner->entries);
+  free(interner);
+}
+
+// Helper to find the slot of text, or the empty slot it would go in.
+static interned_t* find_slot(interned_t* entries, int capacity, const char* text, size_t length, uint64_t hash) {
+  size_t index = (size_t)(hash & (uint64_t)(capacity - 1));
+  for (;;) {
+    interned_t* entry = &entries[index];
+    if (entry->text == NULL ||
+        (entry->hash == hash && entry->length == length && memcmp(entry->text, text, length) == 0)) {
+      return entry;
+    }
+    index = (index + 1) & (size_t)(capacity - 1);
+  }
+}
+
+// Helper to double the capacity, rehashing with the stored hashes.
+static bool grow(interner_t* interner) {
+  int new_capacity = interner->capacity * 2;
+  interned_t* entries = calloc(new_capacity, sizeof(interned_t));
+  if (entries == NULL) {
+    return false;
+  }
+  for (int i = 0; i < interner->capacity; i++) {
+    interned_t* entry = &interner->entries[i];
+    if (entry->text != NULL) {
+      *find_slot(entries, new_capacity, entry->text, entry->length, entry->hash) = *entry;
+    }
+  }
+  free(interner->entries);
+  interner->entries = entries;
+  interner->capacity = new_capacity;
+  return true;
+}
+
+const char* intern(interner_t* interner, const char* text, size_t length) {
+  uint64_t hash = hash_text(text, length);
+  interned_t* entry = find_slot(interner->entries, interner->capacity, text, length, hash);
+  if (entry->text != NULL) {
+    return entry->text;
+  }
+
+  // New string, make room first so the slot stays valid.
+  if (interner->count + 1 > interner->capacity / 2) {
+    if (!grow(interner)) {
+      return NULL;
+    }
+    entry = find_slot(interner->entries, interner->capacity, text, length, hash);
+  }
+  char* copy = arena_strndup(interner->arena, text, length);
+  if (copy == NULL) {
+    return NULL;
+  }
+  entry->text = copy;
+  entry->hash = hash;
+  entry->length = length;
+  interner->count++;
+  return copy;
+}
@@ -0,0 +1,18 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include "arena.h"
+
+// String interner: every distinct string is stored once, so equal strings share one pointer. (opaque, see intern.c)
+typedef struct interner interner_t;
+
+// Creates interner that stores its strings in arena. Returns NULL if memory allocation failed.
+interner_t* create_interner(arena_t* arena);
+// Frees the interner's lookup table. (the strings stay in the arena until it is freed)
+void free_interner(interner_t* interner);
+// Returns the stored, null terminated copy of the first length chars of text, the same pointer every time
+// for the same chars. Returns NULL if memory allocation failed.
+const char* intern(interner_t* interner, const char* text, size_t length);
+
+#endif
@@ -0,0 +1,699 @@
+#include "layered.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Crossing reduction stops after ORDER_PATIENCE phases without fewer crossings, or MAX_ORDER_PHASES in total.
+#define MAX_ORDER_PHASES 96
+#define ORDER_PATIENCE 4
+// Coordinate assignment passes. (each pass places odd and then even layers)
+#define COORDINATE_PASSES 16
+// Dummy nodes pull harder towards their neighbours, which keeps long edges straight.
+#define DUMMY_WEIGHT 4.0
+
+// Working state of the layered layout.
+// Indices below num_real are the graph's nodes, the rest are dummy nodes that split edges spanning
+// several layers into one segment per layer.
+typedef struct {
+  graph_t* g;
+  double node_spacing;
+  int num_real;
+  int num_total;
+  int num_layers;
+  signed char* direction; // Per graph edge: 1 points down, -1 reversed to break a cycle, 0 self loop.
+  int* layer;
+  int* position;          // Index within its layer.
+  int* layer_offsets;     // Layer l: layer_nodes[layer_offsets[l]] up to layer_nodes[layer_offsets[l + 1]], in order.
+  int* layer_nodes;
+  int* best_nodes;        // layer_nodes with the fewest crossings so far.
+  int* up_offsets;        // Neighbours on the layer above: up[up_offsets[v]] up to up[up_offsets[v + 1]].
+  int* up;
+  int* down_offsets;      // Neighbours on the layer below.
+  int* down;
+  int* chain_offsets;     // Dummies of graph edge e, top to bottom: chain[chain_offsets[e]] up to chain[chain_offsets[e + 1]].
+  int* chain;
+  double* x;
+  long long* crossings;   // Per pair of neighbouring layers.
+  int parity;             // Which layers (odd or even) the current phase works on.
+} layered_t;
+
+static void free_layered(layered_t* l) {
+  free(l->direction);
+  free(l->layer);
+  free(l->position);
+  free(l->layer_offsets);
+  free(l->layer_nodes);
+  free(l->best_nodes);
+  free(l->up_offsets);
+  free(l->up);
+  free(l->down_offsets);
+  free(l->down);
+  free(l->chain_offsets);
+  free(l->chain);
+  free(l->x);
+  free(l->crossings);
+}
+
+// Helper to get the end points of graph edge e (from node u) pointing down, returns false for self loops.
+static bool oriented_edge(layered_t* l, int u, int e, int* upper, int* lower) {
+  int v = l->g->edge_targets[e];
+  if (l->direction[e] == 0) {
+    return false;
+  }
+  *upper = l->direction[e] > 0 ? u : v;
+  *lower = l->direction[e] > 0 ? v : u;
+  return true;
+}
+
+// Reverses the back edges of a depth first search, which leaves no cycles.
+static bool remove_cycles(layered_t* l) {
+  graph_t* g = l->g;
+  int n = g->num_nodes;
+  unsigned char* state = calloc(n, 1); // 0 unvisited, 1 on the stack, 2 done.
+  int* stack = malloc(sizeof(int) * n);
+  int* next_edge = malloc(sizeof(int) * n);
+  if (!state || !stack || !next_edge) {
+    free(state);
+    free(stack);
+    free(next_edge);
+    return false;
+  }
+
+  for (int root = 0; root < n; root++) {
+    if (state[root] != 0) {
+      continue;
+    }
+    int top = 0;
+    stack[top++] = root;
+    state[root] = 1;
+    next_edge[root] = g->edge_offsets[root];
+    while (top > 0) {
+      int v = stack[top - 1];
+      if (next_edge[v] == g->edge_offsets[v + 1]) {
+        state[v] = 2;
+        top--;
+        continue;
+      }
+      int e = next_edge[v]++;
+      int w = g->edge_targets[e];
+      if (w == v) {
+        l->direction[e] = 0;
+      } else if (state[w] == 1) {
+        l->direction[e] = -1;
+      } else {
+        l->direction[e] = 1;
+        if (state[w] == 0) {
+          state[w] = 1;
+          next_edge[w] = g->edge_offsets[w];
+          stack[top++] = w;
+        }
+      }
+    }
+  }
+
+  free(state);
+  free(stack);
+  free(next_edge);
+  return true;
+}
+
+// Helper to turn counts in offsets[1..count] into start offsets.
+static void prefix_sum(int* offsets, int count) {
+  for (int i = 0; i < count; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+}
+
+// Helper to undo the cursor moves of filling, so offsets[v] is v's start again.
+static void rewind_offsets(int* offsets, int count) {
+  for (int i = count; i > 0; i--) {
+    offsets[i] = offsets[i - 1];
+  }
+  offsets[0] = 0;
+}
+
+// Puts every node a layer below all of its predecessors (longest path), then moves sources down
+// to just above their highest successor so they don't hang at the top with long edges.
+static bool assign_layers(layered_t* l) {
+  graph_t* g = l->g;
+  int n = g->num_nodes;
+  int* out_offsets = calloc(n + 1, sizeof(int));
+  int* out = malloc(sizeof(int) * (g->num_edges > 0 ? g->num_edges : 1));
+  int* in_degree = calloc(n, sizeof(int));
+  int* queue = malloc(sizeof(int) * n);
+  bool* source = malloc(sizeof(bool) * n);
+  if (!out_offsets || !out || !in_degree || !queue || !source) {
+    free(out_offsets);
+    free(out);
+    free(in_degree);
+    free(queue);
+    free(source);
+    return false;
+  }
+
+  // Downward adjacency.
+  for (int u = 0; u < n; u++) {
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      int upper, lower;
+      if (oriented_edge(l, u, e, &upper, &lower)) {
+        out_offsets[upper + 1]++;
+        in_degree[lower]++;
+      }
+    }
+  }
+  prefix_sum(out_offsets, n);
+  for (int u = 0; u < n; u++) {
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      int upper, lower;
+      if (oriented_edge(l, u, e, &upper, &lower)) {
+        out[out_offsets[upper]++] = lower;
+      }
+    }
+  }
+  rewind_offsets(out_offsets, n);
+
+  // Longest path in topological order. (Kahn)
+  int head = 0;
+  int tail = 0;
+  for (int i = 0; i < n; i++) {
+    l->layer[i] = 0;
+    source[i] = in_degree[i] == 0;
+    if (source[i]) {
+      queue[tail++] = i;
+    }
+  }
+  while (head < tail) {
+    int v = queue[head++];
+    for (int i = out_offsets[v]; i < out_offsets[v + 1]; i++) {
+      int w = out[i];
+      if (l->layer[v] + 1 > l->layer[w]) {
+        l->layer[w] = l->layer[v] + 1;
+      }
+      if (--in_degree[w] == 0) {
+        queue[tail++] = w;
+      }
+    }
+  }
+
+  for (int v = 0; v < n; v++) {
+    if (source[v] && out_offsets[v] < out_offsets[v + 1]) {
+      int highest = l->layer[out[out_offsets[v]]];
+      for (int i = out_offsets[v] + 1; i < out_offsets[v + 1]; i++) {
+        if (l->layer[out[i]] < highest) {
+          highest = l->layer[out[i]];
+        }
+      }
+      l->layer[v] = highest - 1;
+    }
+  }
+
+  l->num_layers = 0;
+  for (int v = 0; v < n; v++) {
+    if (l->layer[v] + 1 > l->num_layers) {
+      l->num_layers = l->layer[v] + 1;
+    }
+  }
+
+  free(out_offsets);
+  free(out);
+  free(in_degree);
+  free(queue);
+  free(source);
+  return true;
+}
+
+// Helper to count (fill false) or store (fill true) a segment between neighbouring layers.
+// Counting bumps offsets[v + 1], storing uses offsets[v] as cursor.
+static void link_nodes(layered_t* l, int upper, int lower, bool fill) {
+  if (fill) {
+    l->down[l->down_offsets[upper]++] = lower;
+    l->up[l->up_offsets[lower]++] = upper;
+  } else {
+    l->down_offsets[upper + 1]++;
+    l->up_offsets[lower + 1]++;
+  }
+}
+
+// Helper to go through every edge's segments (graph node, dummies, graph node).
+static void link_edges(layered_t* l, bool fill) {
+  graph_t* g = l->g;
+  for (int u = 0; u < g->num_nodes; u++) {
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      int upper, lower;
+      if (!oriented_edge(l, u, e, &upper, &lower)) {
+        continue;
+      }
+      int previous = upper;
+      for (int c = l->chain_offsets[e]; c < l->chain_offsets[e + 1]; c++) {
+        link_nodes(l, previous, l->chain[c], fill);
+        previous = l->chain[c];
+      }
+      link_nodes(l, previous, lower, fill);
+    }
+  }
+}
+
+// Adds dummy nodes along edges spanning more than one layer and links neighbouring layers.
+static bool add_dummies(layered_t* l) {
+  graph_t* g = l->g;
+  int n = g->num_nodes;
+  int num_edges = g->num_edges;
+
+  l->chain_offsets = malloc(sizeof(int) * (num_edges + 1));
+  if (l->chain_offsets == NULL) {
+    return false;
+  }
+  l->chain_offsets[0] = 0;
+  for (int u = 0; u < n; u++) {
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      int upper, lower;
+      int dummies = oriented_edge(l, u, e, &upper, &lower) ? l->layer[lower] - l->layer[upper] - 1 : 0;
+      l->chain_offsets[e + 1] = l->chain_offsets[e] + dummies;
+    }
+  }
+
+  int num_dummies = l->chain_offsets[num_edges];
+  l->num_total = n + num_dummies;
+  int* layer = realloc(l->layer, sizeof(int) * l->num_total);
+  if (layer == NULL) {
+    return false;
+  }
+  l->layer = layer;
+  l->chain = malloc(sizeof(int) * (num_dummies > 0 ? num_dummies : 1));
+  l->up_offsets = calloc(l->num_total + 1, sizeof(int));
+  l->down_offsets = calloc(l->num_total + 1, sizeof(int));
+  if (!l->chain || !l->up_offsets || !l->down_offsets) {
+    return false;
+  }
+
+  int next_dummy = n;
+  for (int u = 0; u < n; u++) {
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      int upper, lower;
+      if (!oriented_edge(l, u, e, &upper, &lower)) {
+        continue;
+      }
+      for (int c = l->chain_offsets[e]; c < l->chain_offsets[e + 1]; c++) {
+        l->layer[next_dummy] = l->layer[upper] + 1 + (c - l->chain_offsets[e]);
+        l->chain[c] = next_dummy++;
+      }
+    }
+  }
+
+  // Count, allocate, then store the segments.
+  link_edges(l, false);
+  prefix_sum(l->up_offsets, l->num_total);
+  prefix_sum(l->down_offsets, l->num_total);
+  int num_segments = l->down_offsets[l->num_total];
+  l->up = malloc(sizeof(int) * (num_segments > 0 ? num_segments : 1));
+  l->down = malloc(sizeof(int) * (num_segments > 0 ? num_segments : 1));
+  if (!l->up || !l->down) {
+    return false;
+  }
+  link_edges(l, true);
+  rewind_offsets(l->up_offsets, l->num_total);
+  rewind_offsets(l->down_offsets, l->num_total);
+  return true;
+}
+
+// Orders every layer by a depth first search from the top, so trees start out without crossings.
+static bool initial_order(layered_t* l) {
+  l->layer_offsets = calloc(l->num_layers + 1, sizeof(int));
+  l->layer_nodes = malloc(sizeof(int) * l->num_total);
+  l->best_nodes = malloc(sizeof(int) * l->num_total);
+  l->position = malloc(sizeof(int) * l->num_total);
+  int* cursor = malloc(sizeof(int) * l->num_layers);
+  int* stack = malloc(sizeof(int) * l->num_total);
+  int* next_down = malloc(sizeof(int) * l->num_total);
+  bool* visited = calloc(l->num_total, sizeof(bool));
+  if (!l->layer_offsets || !l->layer_nodes || !l->best_nodes || !l->position || !cursor || !stack || !next_down || !visited) {
+    free(cursor);
+    free(stack);
+    free(next_down);
+    free(visited);
+    return false;
+  }
+
+  for (int v = 0; v < l->num_total; v++) {
+    l->layer_offsets[l->layer[v] + 1]++;
+  }
+  prefix_sum(l->layer_offsets, l->num_layers);
+  memcpy(cursor, l->layer_offsets, sizeof(int) * l->num_layers);
+
+  // Roots are the nodes without anything above them, then anything left over just in case.
+  for (int pass = 0; pass < 2; pass++) {
+    for (int root = 0; root < l->num_total; root++) {
+      if (visited[root] || (pass == 0 && l->up_offsets[root] < l->up_offsets[root + 1])) {
+        continue;
+      }
+      int top = 0;
+      stack[top++] = root;
+      visited[root] = true;
+      next_down[root] = l->down_offsets[root];
+      l->layer_nodes[cursor[l->layer[root]]++] = root;
+      while (top > 0) {
+        int v = stack[top - 1];
+        if (next_down[v] == l->down_offsets[v + 1]) {
+          top--;
+          continue;
+        }
+        int w = l->down[next_down[v]++];
+        if (!visited[w]) {
+          visited[w] = true;
+          next_down[w] = l->down_offsets[w];
+          l->layer_nodes[cursor[l->layer[w]]++] = w;
+          stack[top++] = w;
+        }
+      }
+    }
+  }
+
+  for (int layer = 0; layer < l->num_layers; layer++) {
+    for (int i = l->layer_offsets[layer]; i < l->layer_offsets[layer + 1]; i++) {
+      l->position[l->layer_nodes[i]] = i - l->layer_offsets[layer];
+    }
+  }
+
+  free(cursor);
+  free(stack);
+  free(next_down);
+  free(visited);
+  return true;
+}
+
+// Sort key of a node while reordering a layer.
+typedef struct {
+  double key;
+  int position;
+  int node;
+} order_key_t;
+
+static int compare_order_keys(const void* a, const void* b) {
+  const order_key_t* x = a;
+  const order_key_t* y = b;
+  if (x->key != y->key) {
+    return x->key < y->key ? -1 : 1;
+  }
+  return (x->position > y->position) - (x->position < y->position);
+}
+
+// Helper to get a node's position scaled to [0, 1], so neighbours on layers of different sizes weigh the same.
+static double relative_position(layered_t* l, int v) {
+  int layer = l->layer[v];
+  return (l->position[v] + 0.5) / (l->layer_offsets[layer + 1] - l->layer_offsets[layer]);
+}
+
+// Task reordering one layer by the barycenter of each node's neighbours on both sides.
+// Only layers of one parity run at once, so the neighbouring layers hold still.
+static void reorder_layer(void* context, int index) {
+  layered_t* l = context;
+  int layer = index * 2 + l->parity;
+  int start = l->layer_offsets[layer];
+  int count = l->layer_offsets[layer + 1] - start;
+  order_key_t* keys = malloc(sizeof(order_key_t) * count);
+  if (keys == NULL) {
+    return; // Layer just keeps its order.
+  }
+
+  for (int i = 0; i < count; i++) {
+    int v = l->layer_nodes[start + i];
+    double sum = 0.0;
+    int neighbours = 0;
+    for (int j = l->up_offsets[v]; j < l->up_offsets[v + 1]; j++, neighbours++) {
+      sum += relative_position(l, l->up[j]);
+    }
+    for (int j = l->down_offsets[v]; j < l->down_offsets[v + 1]; j++, neighbours++) {
+      sum += relative_position(l, l->down[j]);
+    }
+    keys[i].key = neighbours > 0 ? sum / neighbours : relative_position(l, v);
+    keys[i].position = i;
+    keys[i].node = v;
+  }
+  qsort(keys, count, sizeof(order_key_t), compare_order_keys);
+
+  for (int i = 0; i < count; i++) {
+    l->layer_nodes[start + i] = keys[i].node;
+    l->position[keys[i].node] = i;
+  }
+  free(keys);
+}
+
+static int compare_ints(const void* a, const void* b) {
+  int x = *(const int*)a;
+  int y = *(const int*)b;
+  return (x > y) - (x < y);
+}
+
+// Task counting the crossings between layer index and the one below it.
+// Segments are read in order of their upper end, crossings are then the inversions in their lower ends,
+// counted with a binary indexed tree.
+static void count_crossings(void* context, int index) {
+  layered_t* l = context;
+  int lower_count = l->layer_offsets[index + 2] - l->layer_offsets[index + 1];
+  int* tree = calloc(lower_count + 1, sizeof(int));
+  int* ends = malloc(sizeof(int) * (lower_count + 1));
+  int ends_capacity = lower_count + 1;
+  long long crossings = 0;
+  int seen = 0;
+  if (!tree || !ends) {
+    free(tree);
+    free(ends);
+    l->crossings[index] = 0;
+    return;
+  }
+
+  for (int i = l->layer_offsets[index]; i < l->layer_offsets[index + 1]; i++) {
+    int v = l->layer_nodes[i];
+    int degree = l->down_offsets[v + 1] - l->down_offsets[v];
+    if (degree > ends_capacity) {
+      int* grown = realloc(ends, sizeof(int) * degree);
+      if (grown == NULL) {
+        break;
+      }
+      ends = grown;
+      ends_capacity = degree;
+    }
+    for (int j = 0; j < degree; j++) {
+      ends[j] = l->position[l->down[l->down_offsets[v] + j]];
+    }
+    qsort(ends, degree, sizeof(int), compare_ints);
+
+    for (int j = 0; j < degree; j++) {
+      // Segments seen so far that end right of this one cross it.
+      int at_or_left = 0;
+      for (int k = ends[j] + 1; k > 0; k -= k & -k) {
+        at_or_left += tree[k];
+      }
+      crossings += seen - at_or_left;
+      for (int k = ends[j] + 1; k <= lower_count; k += k & -k) {
+        tree[k]++;
+      }
+      seen++;
+    }
+  }
+
+  l->crossings[index] = crossings;
+  free(tree);
+  free(ends);
+}
+
+static long long total_crossings(layered_t* l, pool_t* pool) {
+  pool_run(pool, count_crossings, l, l->num_layers - 1);
+  long long total = 0;
+  for (int i = 0; i < l->num_layers - 1; i++) {
+    total += l->crossings[i];
+  }
+  return total;
+}
+
+// Alternates reordering odd and even layers, keeping the order with the fewest crossings.
+static bool reduce_crossings(layered_t* l, pool_t* pool) {
+  l->crossings = malloc(sizeof(long long) * (l->num_layers > 1 ? l->num_layers - 1 : 1));
+  if (l->crossings == NULL) {
+    return false;
+  }
+
+  long long best = total_crossings(l, pool);
+  memcpy(l->best_nodes, l->layer_nodes, sizeof(int) * l->num_total);
+  int phases_without_gain = 0;
+  for (int phase = 0; phase < MAX_ORDER_PHASES && best > 0 && phases_without_gain < ORDER_PATIENCE; phase++) {
+    l->parity = phase % 2;
+    pool_run(pool, reorder_layer, l, (l->num_layers - l->parity + 1) / 2);
+
+    long long crossings = total_crossings(l, pool);
+    if (crossings < best) {
+      best = crossings;
+      memcpy(l->best_nodes, l->layer_nodes, sizeof(int) * l->num_total);
+      phases_without_gain = 0;
+    } else {
+      phases_without_gain++;
+    }
+  }
+
+  memcpy(l->layer_nodes, l->best_nodes, sizeof(int) * l->num_total);
+  for (int layer = 0; layer < l->num_layers; layer++) {
+    for (int i = l->layer_offsets[layer]; i < l->layer_offsets[layer + 1]; i++) {
+      l->position[l->layer_nodes[i]] = i - l->layer_offsets[layer];
+    }
+  }
+  return true;
+}
+
+// Helper to get the space to keep between the centers of neighbouring nodes a and b.
+static double separation(layered_t* l, int a, int b) {
+  double width_a = a < l->num_real ? l->node_spacing : l->node_spacing / 8;
+  double width_b = b < l->num_real ? l->node_spacing : l->node_spacing / 8;
+  return (width_a + width_b) / 2;
+}
+
+// Task placing one layer as close as possible to its neighbours on both sides, keeping its order and spacing.
+// This is a weighted isotonic regression (pool adjacent violators) on x minus each node's minimum offset.
+static void place_layer(void* context, int index) {
+  layered_t* l = context;
+  int layer = index * 2 + l->parity;
+  int start = l->layer_offsets[layer];
+  int count = l->layer_offsets[layer + 1] - start;
+  double* offset = malloc(sizeof(double) * count);
+  double* block_weight = malloc(sizeof(double) * count);
+  double* block_sum = malloc(sizeof(double) * count);
+  int* block_end = malloc(sizeof(int) * count);
+  if (!offset || !block_weight || !block_sum || !block_end) {
+    free(offset);
+    free(block_weight);
+    free(block_sum);
+    free(block_end);
+    return; // Layer just stays where it is.
+  }
+
+  int blocks = 0;
+  for (int i = 0; i < count; i++) {
+    int v = l->layer_nodes[start + i];
+    offset[i] = i == 0 ? 0.0 : offset[i - 1] + separation(l, l->layer_nodes[start + i - 1], v);
+
+    double sum = 0.0;
+    int neighbours = 0;
+    for (int j = l->up_offsets[v]; j < l->up_offsets[v + 1]; j++, neighbours++) {
+      sum += l->x[l->up[j]];
+    }
+    for (int j = l->down_offsets[v]; j < l->down_offsets[v + 1]; j++, neighbours++) {
+      sum += l->x[l->down[j]];
+    }
+    double target = neighbours > 0 ? sum / neighbours : l->x[v];
+    double weight = v < l->num_real ? 1.0 : DUMMY_WEIGHT;
+
+    // New block, merged backwards while it would sit left of the block before it.
+    block_weight[blocks] = weight;
+    block_sum[blocks] = weight * (target - offset[i]);
+    block_end[blocks] = i + 1;
+    blocks++;
+    while (blocks > 1 && block_sum[blocks - 2] / block_weight[blocks - 2] > block_sum[blocks - 1] / block_weight[blocks - 1]) {
+      block_weight[blocks - 2] += block_weight[blocks - 1];
+      block_sum[blocks - 2] += block_sum[blocks - 1];
+      block_end[blocks - 2] = block_end[blocks - 1];
+      blocks--;
+    }
+  }
+
+  int i = 0;
+  for (int b = 0; b < blocks; b++) {
+    double shift = block_sum[b] / block_weight[b];
+    for (; i < block_end[b]; i++) {
+      l->x[l->layer_nodes[start + i]] = shift + offset[i];
+    }
+  }
+
+  free(offset);
+  free(block_weight);
+  free(block_sum);
+  free(block_end);
+}
+
+// Spaces out every layer, then alternately moves odd and even layers towards their neighbours.
+static bool assign_coordinates(layered_t* l, pool_t* pool) {
+  l->x = malloc(sizeof(double) * l->num_total);
+  if (l->x == NULL) {
+    return false;
+  }
+
+  for (int layer = 0; layer < l->num_layers; layer++) {
+    for (int i = l->layer_offsets[layer]; i < l->layer_offsets[layer + 1]; i++) {
+      int v = l->layer_nodes[i];
+      l->x[v] = i == l->layer_offsets[layer] ? 0.0 : l->x[l->layer_nodes[i - 1]] + separation(l, l->layer_nodes[i - 1], v);
+    }
+  }
+
+  for (int pass = 0; pass < COORDINATE_PASSES * 2; pass++) {
+    l->parity = pass % 2;
+    pool_run(pool, place_layer, l, (l->num_layers - l->parity + 1) / 2);
+  }
+  return true;
+}
+
+// Helper to copy positions to the graph's nodes and dummies to the graph's edge bends.
+static bool store_layout(layered_t* l, double layer_spacing) {
+  graph_t* g = l->g;
+  int num_bends = l->chain_offsets[g->num_edges];
+
+  free(g->edge_bend_offsets);
+  free(g->edge_bends);
+  g->edge_bend_offsets = malloc(sizeof(int) * (g->num_edges + 1));
+  g->edge_bends = malloc(sizeof(point_t) * (num_bends > 0 ? num_bends : 1));
+  if (g->edge_bend_offsets == NULL || g->edge_bends == NULL) {
+    free(g->edge_bend_offsets);
+    free(g->edge_bends);
+    g->edge_bend_offsets = NULL;
+    g->edge_bends = NULL;
+    return false;
+  }
+
+  double min_x = 0.0;
+  for (int v = 0; v < l->num_total; v++) {
+    if (v == 0 || l->x[v] < min_x) {
+      min_x = l->x[v];
+    }
+  }
+  for (int v = 0; v < l->num_real; v++) {
+    g->x[v] = l->x[v] - min_x;
+    g->y[v] = l->layer[v] * layer_spacing;
+  }
+
+  // Bends go from the edge's from node to its to node, so reversed edges walk their chain backwards.
+  for (int u = 0; u < g->num_nodes; u++) {
+    for (int e = g->edge_offsets[u]; e < g->edge_offsets[u + 1]; e++) {
+      int first = l->chain_offsets[e];
+      int count = l->chain_offsets[e + 1] - first;
+      g->edge_bend_offsets[e] = first;
+      for (int i = 0; i < count; i++) {
+        int d = l->chain[l->direction[e] > 0 ? first + i : first + count - 1 - i];
+        g->edge_bends[first + i].x = l->x[d] - min_x;
+        g->edge_bends[first + i].y = l->layer[d] * layer_spacing;
+      }
+    }
+  }
+  g->edge_bend_offsets[g->num_edges] = num_bends;
+  return true;
+}
+
+bool layout_layered(graph_t* g, double node_spacing, double layer_spacing, pool_t* pool) {
+  if (g->num_nodes == 0) {
+    return true;
+  }
+
+  layered_t l = { .g = g, .node_spacing = node_spacing, .num_real = g->num_nodes };
+  l.direction = malloc(g->num_edges > 0 ? g->num_edges : 1);
+  l.layer = malloc(sizeof(int) * g->num_nodes);
+  bool ok = l.direction != NULL && l.layer != NULL &&
+            remove_cycles(&l) &&
+            assign_layers(&l) &&
+            add_dummies(&l) &&
+            initial_order(&l) &&
+            reduce_crossings(&l, pool) &&
+            assign_coordinates(&l, pool) &&
+            store_layout(&l, layer_spacing);
+  if (!ok) {
+    fprintf(g->errors, "Memory allocation failed for layered layout.\n");
+  }
+
+  free_layered(&l);
+  return ok;
+}
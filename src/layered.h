@@ -0,0 +1,16 @@
+#ifndef LAYERED_H
+#define LAYERED_H
+
+#include <stdbool.h>
+#include "graph.h"
+#include "pool.h"
+
+// Places every node's x_pos and y_pos with a layered (Sugiyama) layout, for graphs that aren't trees.
+// Cycles are broken by reversing edges, nodes go on layers layer_spacing apart, edges spanning several
+// layers are routed through bend points (stored in the graph's edge_bends), and nodes are ordered within
+// their layers to reduce crossings. Sweeps are spread over pool's threads. (pool can be NULL)
+// The leftmost point ends up at x = 0 and the top layer at y = 0.
+// Returns false if memory allocation failed.
+bool layout_layered(graph_t* g, double node_spacing, double layer_spacing, pool_t* pool);
+
+#endif
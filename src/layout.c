@@ -0,0 +1,271 @@
+#include "layout.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+// Working state of the tree layout, indexed by node id.
+// Index num_nodes is a virtual root above every tree, so a forest is laid out as one tree.
+typedef struct {
+  int size;           // num_nodes + 1.
+  int* parent;        // -1 for the virtual root.
+  int* child_offsets; // Children of i: children[child_offsets[i]] up to children[child_offsets[i + 1]].
+  int* children;
+  int* number;        // Index among its siblings.
+  int* order;         // Breadth first order, parents before children.
+  int* thread;        // Next node on the subtree's contour when it has no children, -1 if none.
+  int* ancestor;
+  double* prelim;     // Preliminary x relative to the parent's subtree.
+  double* mod;        // Offset added to the whole subtree (except the node itself).
+  double* shift;
+  double* change;
+} tree_layout_t;
+
+static void free_tree_layout(tree_layout_t* t) {
+  free(t->parent);
+  free(t->child_offsets);
+  free(t->children);
+  free(t->number);
+  free(t->order);
+  free(t->thread);
+  free(t->ancestor);
+  free(t->prelim);
+  free(t->mod);
+  free(t->shift);
+  free(t->change);
+}
+
+// Helper to build the children lists (in node id order) and breadth first order from the nodes' parents.
+static bool init_tree_layout(tree_layout_t* t, graph_t* g) {
+  int n = g->num_nodes;
+  int root = n;
+  t->size = n + 1;
+  t->parent = malloc(sizeof(int) * t->size);
+  t->child_offsets = calloc(t->size + 1, sizeof(int));
+  t->children = malloc(sizeof(int) * t->size);
+  t->number = malloc(sizeof(int) * t->size);
+  t->order = malloc(sizeof(int) * t->size);
+  t->thread = malloc(sizeof(int) * t->size);
+  t->ancestor = malloc(sizeof(int) * t->size);
+  t->prelim = calloc(t->size, sizeof(double));
+  t->mod = calloc(t->size, sizeof(double));
+  t->shift = calloc(t->size, sizeof(double));
+  t->change = calloc(t->size, sizeof(double));
+  if (!t->parent || !t->child_offsets || !t->children || !t->number || !t->order || !t->thread ||
+      !t->ancestor || !t->prelim || !t->mod || !t->shift || !t->change) {
+    return false;
+  }
+
+  // Count children, nodes without a parent hang off the virtual root.
+  for (int i = 0; i < n; i++) {
+    t->parent[i] = g->parents[i] != -1 ? g->parents[i] : root;
+    t->child_offsets[t->parent[i] + 1]++;
+  }
+  t->parent[root] = -1;
+  for (int i = 0; i < t->size; i++) {
+    t->child_offsets[i + 1] += t->child_offsets[i];
+  }
+
+  // Fill children in id order (number doubles as a fill cursor per parent).
+  for (int i = 0; i < t->size; i++) {
+    t->number[i] = 0;
+  }
+  for (int i = 0; i < n; i++) {
+    int p = t->parent[i];
+    t->children[t->child_offsets[p] + t->number[p]++] = i;
+  }
+  for (int i = 0; i < t->size; i++) {
+    for (int c = t->child_offsets[i]; c < t->child_offsets[i + 1]; c++) {
+      t->number[t->children[c]] = c - t->child_offsets[i];
+    }
+    t->thread[i] = -1;
+    t->ancestor[i] = i;
+  }
+  t->number[root] = 0;
+
+  // Breadth first order (every node is reachable since parents are always a level up).
+  int count = 0;
+  t->order[count++] = root;
+  for (int head = 0; head < count; head++) {
+    int v = t->order[head];
+    for (int c = t->child_offsets[v]; c < t->child_offsets[v + 1]; c++) {
+      t->order[count++] = t->children[c];
+    }
+  }
+  return true;
+}
+
+static bool is_leaf(tree_layout_t* t, int v) {
+  return t->child_offsets[v] == t->child_offsets[v + 1];
+}
+
+static int leftmost_child(tree_layout_t* t, int v) {
+  return t->children[t->child_offsets[v]];
+}
+
+static int rightmost_child(tree_layout_t* t, int v) {
+  return t->children[t->child_offsets[v + 1] - 1];
+}
+
+// Returns the sibling left of v, -1 if v is the leftmost.
+static int left_sibling(tree_layout_t* t, int v) {
+  return t->number[v] > 0 ? t->children[t->child_offsets[t->parent[v]] + t->number[v] - 1] : -1;
+}
+
+// Next node on the left contour of v's subtree.
+static int next_left(tree_layout_t* t, int v) {
+  return is_leaf(t, v) ? t->thread[v] : leftmost_child(t, v);
+}
+
+// Next node on the right contour of v's subtree.
+static int next_right(tree_layout_t* t, int v) {
+  return is_leaf(t, v) ? t->thread[v] : rightmost_child(t, v);
+}
+
+// Shifts subtree right of wm (rooted at wp) by shift, spreading the shift over the subtrees between them.
+static void move_subtree(tree_layout_t* t, int wm, int wp, double shift) {
+  double subtrees = t->number[wp] - t->number[wm];
+  t->change[wp] -= shift / subtrees;
+  t->shift[wp] += shift;
+  t->change[wm] += shift / subtrees;
+  t->prelim[wp] += shift;
+  t->mod[wp] += shift;
+}
+
+// Applies the shifts queued up by move_subtree to v's children.
+static void execute_shifts(tree_layout_t* t, int v) {
+  double shift = 0.0;
+  double change = 0.0;
+  for (int c = t->child_offsets[v + 1] - 1; c >= t->child_offsets[v]; c--) {
+    int w = t->children[c];
+    t->prelim[w] += shift;
+    t->mod[w] += shift;
+    change += t->change[w];
+    shift += t->shift[w] + change;
+  }
+}
+
+// Places v's subtree right of its left siblings' subtrees, comparing their contours level by level.
+// Returns the new default ancestor.
+static int apportion(tree_layout_t* t, int v, int default_ancestor, double spacing) {
+  int w = left_sibling(t, v);
+  if (w == -1) {
+    return default_ancestor;
+  }
+
+  // Inside/outside contours on the right (p) and left (m) side, with their accumulated mods.
+  int vip = v;
+  int vop = v;
+  int vim = w;
+  int vom = leftmost_child(t, t->parent[v]);
+  double sip = t->mod[vip];
+  double sop = t->mod[vop];
+  double sim = t->mod[vim];
+  double som = t->mod[vom];
+
+  while (next_right(t, vim) != -1 && next_left(t, vip) != -1) {
+    vim = next_right(t, vim);
+    vip = next_left(t, vip);
+    vom = next_left(t, vom);
+    vop = next_right(t, vop);
+    t->ancestor[vop] = v;
+
+    double shift = (t->prelim[vim] + sim) - (t->prelim[vip] + sip) + spacing;
+    if (shift > 0) {
+      // The greatest uncommon ancestor of vim, if it is one of v's siblings.
+      int a = t->parent[t->ancestor[vim]] == t->parent[v] ? t->ancestor[vim] : default_ancestor;
+      move_subtree(t, a, v, shift);
+      sip += shift;
+      sop += shift;
+    }
+    sim += t->mod[vim];
+    sip += t->mod[vip];
+    som += t->mod[vom];
+    sop += t->mod[vop];
+  }
+
+  // Thread the shorter contour onto the longer one.
+  if (next_right(t, vim) != -1 && next_right(t, vop) == -1) {
+    t->thread[vop] = next_right(t, vim);
+    t->mod[vop] += sim - sop;
+  }
+  if (next_left(t, vip) != -1 && next_left(t, vom) == -1) {
+    t->thread[vom] = next_left(t, vip);
+    t->mod[vom] += sip - som;
+    default_ancestor = v;
+  }
+  return default_ancestor;
+}
+
+// Lays out the tree (Buchheim, Junger and Leipert's linear time version of Walker's algorithm).
+// Walks are done in breadth first order instead of recursion, so deep trees don't overflow the stack.
+bool layout_tree(graph_t* g, double node_spacing, double level_spacing) {
+  if (g->num_nodes == 0) {
+    return true;
+  }
+
+  tree_layout_t t;
+  if (!init_tree_layout(&t, g)) {
+    fprintf(g->errors, "Memory allocation failed for tree layout.\n");
+    free_tree_layout(&t);
+    return false;
+  }
+
+  // First walk: children before parents.
+  // A node's prelim starts out as the midpoint of its children, and is only moved next to its left sibling
+  // by the parent, once that sibling's subtree has been apportioned.
+  for (int i = t.size - 1; i >= 0; i--) {
+    int v = t.order[i];
+    if (is_leaf(&t, v)) {
+      t.prelim[v] = 0.0;
+      continue;
+    }
+
+    int default_ancestor = leftmost_child(&t, v);
+    for (int c = t.child_offsets[v]; c < t.child_offsets[v + 1]; c++) {
+      int child = t.children[c];
+      int w = left_sibling(&t, child);
+      if (w != -1) {
+        double midpoint = t.prelim[child];
+        t.prelim[child] = t.prelim[w] + node_spacing;
+        if (!is_leaf(&t, child)) {
+          t.mod[child] = t.prelim[child] - midpoint;
+        }
+      }
+      default_ancestor = apportion(&t, child, default_ancestor, node_spacing);
+    }
+    execute_shifts(&t, v);
+
+    t.prelim[v] = (t.prelim[leftmost_child(&t, v)] + t.prelim[rightmost_child(&t, v)]) / 2;
+  }
+
+  // Second walk: parents before children, summing the mods of each node's ancestors.
+  // (shift is done with, so it holds the sums)
+  double min_x = 0.0;
+  t.shift[g->num_nodes] = 0.0;
+  for (int i = 0; i < t.size; i++) {
+    int v = t.order[i];
+    if (t.parent[v] != -1) {
+      int p = t.parent[v];
+      t.shift[v] = t.shift[p] + t.mod[p];
+      double x = t.prelim[v] + t.shift[v];
+      g->x[v] = x;
+      if (i == 1 || x < min_x) {
+        min_x = x;
+      }
+    }
+  }
+
+  // Move leftmost node to 0, and the top level to 0.
+  int min_level = g->levels[0];
+  for (int i = 1; i < g->num_nodes; i++) {
+    if (g->levels[i] < min_level) {
+      min_level = g->levels[i];
+    }
+  }
+  for (int i = 0; i < g->num_nodes; i++) {
+    g->x[i] -= min_x;
+    g->y[i] = (g->levels[i] - min_level) * level_spacing;
+  }
+
+  free_tree_layout(&t);
+  return true;
+}
@@ -0,0 +1,14 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdbool.h>
+#include "graph.h"
+
+// Places every node with a tidy tree layout (Buchheim-Walker, linear time) of the parent/children relation.
+// Neighbouring nodes on a level end up node_spacing apart, parents centered over their children,
+// separate trees are packed side by side, and levels (see assign_levels) are level_spacing apart.
+// The leftmost node ends up at x = 0 and the top level at y = 0.
+// Returns false if memory allocation failed.
+bool layout_tree(graph_t* g, double node_spacing, double level_spacing);
+
+#endif
@@ -1,33 +1,107 @@
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "lexer.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Character classes.
+#define CLASS_IDENTIFIER 1 // Letters, digits and '_'.
+#define CLASS_SPACE 2      // Whitespace other than newlines.
+
+// Character class of every byte, so scanning identifiers and whitespace is one load and test per char.
+static const uint8_t char_class[256] = {
+  //       0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f
+  /* 0 */  0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 2, 0, 0,
+  /* 1 */  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  /* 2 */  2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  /* 3 */  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+  /* 4 */  0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  /* 5 */  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,
+  /* 6 */  0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  /* 7 */  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+  // Bytes 0x80 and up are all 0.
+};
+
+// Bytes looked at per step when searching comments and strings.
+#if defined(__AVX2__)
+#define SCAN_WIDTH 32
+#elif defined(__SSE2__)
+#define SCAN_WIDTH 16
+#endif
+
+#ifdef SCAN_WIDTH
+// Helper to get a bit mask of the bytes of the aligned block at p that are a, b or '\0'.
+static unsigned match_block(const char* p, char a, char b) {
+#if defined(__AVX2__)
+  __m256i block = _mm256_load_si256((const __m256i*)p);
+  __m256i found = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(a)),
+                                  _mm256_cmpeq_epi8(block, _mm256_set1_epi8(b)));
+  found = _mm256_or_si256(found, _mm256_cmpeq_epi8(block, _mm256_setzero_si256()));
+  return (unsigned)_mm256_movemask_epi8(found);
+#else
+  __m128i block = _mm_load_si128((const __m128i*)p);
+  __m128i found = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(a)),
+                               _mm_cmpeq_epi8(block, _mm_set1_epi8(b)));
+  found = _mm_or_si128(found, _mm_cmpeq_epi8(block, _mm_setzero_si128()));
+  return (unsigned)_mm_movemask_epi8(found);
+#endif
+}
+#endif
+
+// Returns the first char from p on that is a, b or the terminating '\0'.
+// Blocks are loaded aligned, so reads past the '\0' never leave its page.
+static const char* find_any(const char* p, char a, char b) {
+#ifdef SCAN_WIDTH
+  size_t offset = (uintptr_t)p % SCAN_WIDTH;
+  const char* block = p - offset;
+  // Drop the bytes before p.
+  unsigned found = match_block(block, a, b) >> offset;
+  if (found != 0) {
+    return p + __builtin_ctz(found);
+  }
+  for (;;) {
+    block += SCAN_WIDTH;
+    found = match_block(block, a, b);
+    if (found != 0) {
+      return block + __builtin_ctz(found);
+    }
+  }
+#else
+  while (*p != a && *p != b && *p != '\0') p++;
+  return p;
+#endif
+}
+
 // Initialize lexer
-lexer_t* init_lexer(const char* source) {
-  lexer_t* lexer = malloc(sizeof(lexer_t*));
+lexer_t* init_lexer(const char* source, size_t length) {
+  lexer_t* lexer = malloc(sizeof(lexer_t));
   if (lexer == NULL) {
     return NULL;
   }
   lexer->start = source;
   lexer->current = source;
+  lexer->end = source + length;
   lexer->line = 1;
+  lexer->open_comment = false;
   return lexer;
 }
 
 // Helper to check if char is alphanumeric.
 static bool is_alphanum(char c) {
-  return (c >= 'a' && c <= 'z') ||
-         (c >= 'A' && c <= 'Z') ||
-         (c >= '0' && c <= '9') ||
-          c == '_';
+  return char_class[(unsigned char)c] & CLASS_IDENTIFIER;
 }
 
 // Helper to check if at end of source.
 static bool is_at_end(lexer_t* lexer) {
-  return *lexer->current == '\0';
+  return lexer->current >= lexer->end;
 }
 
 // Advances to next char in source.
@@ -38,15 +112,22 @@ static char advance(lexer_t* lexer) {
 
 // Peek but don't move on to next char.
 static char peek(lexer_t* lexer) {
+  if (is_at_end(lexer)) return '\0';
   return *lexer->current;
 }
 
 // Peek at upcoming next char.
 static char peek_next(lexer_t* lexer) {
-  if (is_at_end(lexer)) return '\0';
+  if (lexer->current + 1 >= lexer->end) return '\0';
   return lexer->current[1];
 }
 
+// Helper to find the first a or b from the current char on, or the end of the source.
+static const char* find_in_source(lexer_t* lexer, char a, char b) {
+  const char* p = find_any(lexer->current, a, b);
+  return p < lexer->end ? p : lexer->end;
+}
+
 // Check if lexer's current matches the expected char, if so, advance.
 static bool match(lexer_t* lexer, char expected) {
   if (is_at_end(lexer)) return false;
@@ -80,39 +161,42 @@ static token error_token(lexer_t* lexer, const char* message) {
   return token;
 }
 
+// Skips a "/* */" comment, starting after the "/*". Newlines inside it are counted.
+static void skip_block_comment(lexer_t* lexer) {
+  for (;;) {
+    const char* p = find_in_source(lexer, '*', '\n');
+    if (p == lexer->end) {
+      // Unterminated, the comment goes until the end.
+      lexer->current = p;
+      lexer->open_comment = true;
+      return;
+    }
+    lexer->current = p + 1;
+    if (*p == '\n') {
+      lexer->line++;
+    } else if (peek(lexer) == '/') {
+      // Advance past the closing "*/"
+      lexer->current++;
+      return;
+    }
+  }
+}
+
 // Skip all whitespace except for newlines.
 static void skip_whitespace(lexer_t* lexer) {
   for (;;) {
     char c = peek(lexer);
-    switch (c) {
-      case ' ':
-      case '\r':
-      case '\t':
-        advance(lexer);
-        break;
-      case '/':
-        if (peek_next(lexer) == '/') {
-          // A comment goes until the end of the line.
-          while (peek(lexer) != '\n' && !is_at_end(lexer)) advance(lexer);
-        } else if (peek_next(lexer) == '*') {
-          // Advance past the "/*"
-          advance(lexer);
-          advance(lexer);
-          // A comment goes until we find the closing "*/"
-          while ((peek(lexer) != '*' || peek_next(lexer) != '/') && !is_at_end(lexer)) {
-            advance(lexer);
-          }
-          // Advance past the closing "*/"
-          if (!is_at_end(lexer)) {
-            advance(lexer);
-            advance(lexer);
-          }
-        } else {
-          return;
-        }
-        break;
-      default:
-        return;
+    if (char_class[(unsigned char)c] & CLASS_SPACE) {
+      advance(lexer);
+    } else if (c == '/' && peek_next(lexer) == '/') {
+      // A comment goes until the end of the line.
+      lexer->current = find_in_source(lexer, '\n', '\n');
+    } else if (c == '/' && peek_next(lexer) == '*') {
+      // Advance past the "/*"
+      lexer->current += 2;
+      skip_block_comment(lexer);
+    } else {
+      return;
     }
   }
 }
@@ -125,19 +209,15 @@ static token identifier(lexer_t* lexer) {
 
 // Consumes up to quotes to create string.
 static token string(lexer_t* lexer, const char quote) {
-  while (peek(lexer) != quote && !is_at_end(lexer)) {
-    if (peek(lexer) == '\n') return error_token(lexer, "Unterminated string.");
-    advance(lexer);
-  }
-
-  if (is_at_end(lexer)) return error_token(lexer, "Unterminated string.");
+  lexer->current = find_in_source(lexer, quote, '\n');
+  if (peek(lexer) != quote) return error_token(lexer, "Unterminated string.");
 
   // Advance past the closing quote.
   advance(lexer);
   return make_token(lexer, TOKEN_STRING);
 }
 
-// Scans for and creates the next token from the source. 
+// Scans for and creates the next token from the source.
 token scan_token(lexer_t* lexer) {
   // Before anything, skip whitespace.
   skip_whitespace(lexer);
@@ -164,9 +244,12 @@ token scan_token(lexer_t* lexer) {
     }
     case '"': return string(lexer, '"');
     case '\'': return string(lexer, '\'');
-    case '\n':
+    case '\n': {
+      // The newline belongs to the line it ends.
+      token newline = make_token(lexer, TOKEN_NEWLINE);
       lexer->line++;
-      return make_token(lexer, TOKEN_NEWLINE);
+      return newline;
+    }
   }
 
   return error_token(lexer, "Unexpected character.");
@@ -1,6 +1,9 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 // Token types
 typedef enum {
   // Single-character tokens.
@@ -26,12 +29,15 @@ typedef struct {
 typedef struct {
   const char* start;
   const char* current;
+  const char* end;   // Lexing stops here, the char at end is read by block scans but never part of a token.
   int line;
+  bool open_comment; // Source ended inside a "/* */" comment.
 } lexer_t;
 
-// Creates and returns initialized lexer.
-lexer_t* init_lexer(const char* source);
+// Creates and returns initialized lexer over the first length chars of source.
+// The source text has to be followed by a '\0' somewhere at or after source + length.
+lexer_t* init_lexer(const char* source, size_t length);
 // Scans and returns token from source text.
-token scan_token();
+token scan_token(lexer_t* lexer);
 
 #endif
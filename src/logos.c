@@ -0,0 +1,305 @@
+#include "logos.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "parser.h"
+#include "source.h"
+#include "binary.h"
+#include "cache.h"
+#include "graph.h"
+#include "pool.h"
+
+// Everything a context holds. (opaque to library users, see logos.h)
+struct logos_ctx {
+  draw_options_t options; // How graphs are laid out and drawn. (options.pool is borrowed, contexts can share one)
+  FILE* errors;           // Where errors and warnings are printed.
+  graph_t* graph;         // Graph of the last source parsed, NULL before that or if it failed.
+  const char* cache_dir;  // Where logos_render_source caches outputs, NULL to not cache.
+  int cache_hits;         // Outputs logos_render_source found in the cache.
+  int cache_misses;       // Outputs logos_render_source had to draw.
+  char* output_path;      // Where the prepared output is drawn to, NULL if nothing is prepared.
+  bool cached;            // The prepared output is in the cache under key, so there is nothing to draw.
+  char key[CACHE_KEY_LENGTH + 1]; // Cache key of the prepared source, "" if it isn't cached.
+};
+
+logos_ctx_t* logos_create(void) {
+  logos_ctx_t* ctx = malloc(sizeof(logos_ctx_t));
+  if (ctx == NULL) {
+    return NULL;
+  }
+  ctx->options = (draw_options_t){
+    .bg_color = "white",
+    .node_color = "white",
+    .text_size = 24,
+    .compress_level = -1,
+    .format = OUTPUT_SVG,
+    .layout = LAYOUT_TREE,
+    .pool = NULL,
+  };
+  ctx->errors = stderr;
+  ctx->graph = NULL;
+  ctx->cache_dir = NULL;
+  ctx->cache_hits = 0;
+  ctx->cache_misses = 0;
+  ctx->output_path = NULL;
+  ctx->cached = false;
+  ctx->key[0] = '\0';
+  return ctx;
+}
+
+logos_ctx_t* logos_clone(const logos_ctx_t* ctx) {
+  logos_ctx_t* clone = logos_create();
+  if (clone == NULL) {
+    return NULL;
+  }
+  clone->options = ctx->options;
+  clone->errors = ctx->errors;
+  clone->cache_dir = ctx->cache_dir;
+  return clone;
+}
+
+void logos_free(logos_ctx_t* ctx) {
+  if (ctx == NULL) {
+    return;
+  }
+  free_graph(ctx->graph);
+  free(ctx->output_path);
+  free(ctx);
+}
+
+// Helper to forget the prepared output, once the graph it came from is replaced.
+static void clear_prepared(logos_ctx_t* ctx) {
+  free(ctx->output_path);
+  ctx->output_path = NULL;
+  ctx->cached = false;
+  ctx->key[0] = '\0';
+}
+
+logos_pool_t* logos_pool_create(int threads) {
+  return pool_create(threads);
+}
+
+int logos_cpu_count(void) {
+  return pool_cpu_count();
+}
+
+void logos_pool_free(logos_pool_t* pool) {
+  pool_free(pool);
+}
+
+void logos_set_errors(logos_ctx_t* ctx, FILE* errors) {
+  ctx->errors = errors;
+}
+
+// Colors are only ever read, the options just aren't const.
+void logos_set_background_color(logos_ctx_t* ctx, const char* color) {
+  ctx->options.bg_color = (char*)color;
+}
+
+void logos_set_node_color(logos_ctx_t* ctx, const char* color) {
+  ctx->options.node_color = (char*)color;
+}
+
+void logos_set_text_size(logos_ctx_t* ctx, int size) {
+  ctx->options.text_size = size;
+}
+
+void logos_set_format(logos_ctx_t* ctx, logos_format_t format) {
+  ctx->options.format = format == LOGOS_FORMAT_PNG ? OUTPUT_PNG : OUTPUT_SVG;
+}
+
+void logos_set_layout(logos_ctx_t* ctx, logos_layout_t layout) {
+  switch (layout) {
+    case LOGOS_LAYOUT_LAYERED:
+      ctx->options.layout = LAYOUT_LAYERED;
+      break;
+    case LOGOS_LAYOUT_FORCE:
+      ctx->options.layout = LAYOUT_FORCE;
+      break;
+    default:
+      ctx->options.layout = LAYOUT_TREE;
+  }
+}
+
+void logos_set_compression(logos_ctx_t* ctx, int level) {
+  ctx->options.compress_level = level;
+}
+
+void logos_set_pool(logos_ctx_t* ctx, logos_pool_t* pool) {
+  ctx->options.pool = pool;
+}
+
+void logos_set_cache_dir(logos_ctx_t* ctx, const char* dir) {
+  ctx->cache_dir = dir;
+}
+
+int logos_cache_hits(const logos_ctx_t* ctx) {
+  return ctx->cache_hits;
+}
+
+int logos_cache_misses(const logos_ctx_t* ctx) {
+  return ctx->cache_misses;
+}
+
+bool logos_parse(logos_ctx_t* ctx, const char* source, size_t length) {
+  clear_prepared(ctx);
+  free_graph(ctx->graph);
+  ctx->graph = NULL;
+  interpret_result_t result = interpret(source, length, ctx->options.pool, ctx->errors);
+  if (result.had_error) {
+    free_graph(result.graph);
+    return false;
+  }
+  ctx->graph = result.graph;
+  return true;
+}
+
+bool logos_parse_file(logos_ctx_t* ctx, const char* path) {
+  source_t source;
+  if (!read_source(path, &source, ctx->errors)) {
+    free_graph(ctx->graph);
+    ctx->graph = NULL;
+    return false;
+  }
+  // The graph keeps its own copies of names and texts, so the source can go right away.
+  bool parsed = logos_parse(ctx, source.text, source.length);
+  free_source(&source);
+  return parsed;
+}
+
+void logos_print_graph(const logos_ctx_t* ctx) {
+  if (ctx->graph != NULL) {
+    print_graph(ctx->graph);
+  }
+}
+
+bool logos_load_binary(logos_ctx_t* ctx, const char* path) {
+  clear_prepared(ctx);
+  free_graph(ctx->graph);
+  ctx->graph = read_graph_binary(path, ctx->errors);
+  return ctx->graph != NULL;
+}
+
+// Helper to lay out ctx's graph the first time it is needed. (graphs are laid out once, loaded ones already are)
+static bool lay_out(logos_ctx_t* ctx) {
+  if (ctx->graph == NULL) {
+    fprintf(ctx->errors, "No graph to draw.\n");
+    return false;
+  }
+  return ctx->graph->width > 0 || layout_graph(ctx->graph, &ctx->options);
+}
+
+bool logos_save_binary(logos_ctx_t* ctx, const char* path) {
+  return lay_out(ctx) && write_graph_binary(ctx->graph, path);
+}
+
+bool logos_render(logos_ctx_t* ctx, const char* path) {
+  return lay_out(ctx) && render_graph(ctx->graph, &ctx->options, path);
+}
+
+// Helper to draw ctx's graph to filename through a private file next to it, which is stored in the cache under key
+// (unless it is "") and then renamed over filename. So the cache gets exactly what this call drew, and an old output
+// that is a link to a cache entry is replaced instead of written through.
+static bool render_through_private_file(logos_ctx_t* ctx, const char* filename, const char* key) {
+  // A directory of its own is the only way to get a fresh name that fopen then creates with the usual permissions.
+  size_t length = strlen(filename) + sizeof(".XXXXXX/output");
+  char* directory = malloc(length);
+  char* path = malloc(length);
+  if (directory == NULL || path == NULL) {
+    fprintf(ctx->errors, "Memory allocation failed for filename\n");
+    free(directory);
+    free(path);
+    return false;
+  }
+  snprintf(directory, length, "%s.XXXXXX", filename);
+  if (mkdtemp(directory) == NULL) {
+    fprintf(ctx->errors, "Could not open output file \"%s\".\n", filename);
+    free(directory);
+    free(path);
+    return false;
+  }
+  snprintf(path, length, "%s/output", directory);
+
+  bool rendered = render_graph(ctx->graph, &ctx->options, path);
+  if (rendered && key[0] != '\0') {
+    cache_store(ctx->cache_dir, key, path, filename, ctx->errors);
+  }
+  if (rendered && rename(path, filename) != 0) {
+    fprintf(ctx->errors, "Could not write output file \"%s\".\n", filename);
+    rendered = false;
+  }
+  unlink(path);
+  rmdir(directory);
+  free(directory);
+  free(path);
+  return rendered;
+}
+
+bool logos_prepare_source(logos_ctx_t* ctx, const char* source, size_t length) {
+  char key[CACHE_KEY_LENGTH + 1] = "";
+  if (ctx->cache_dir != NULL) {
+    cache_key(source, length, &ctx->options, key);
+    char* name = cache_lookup(ctx->cache_dir, key);
+    if (name != NULL) {
+      ctx->cache_hits++;
+      clear_prepared(ctx);
+      free_graph(ctx->graph);
+      ctx->graph = NULL;
+      ctx->output_path = name;
+      ctx->cached = true;
+      memcpy(ctx->key, key, sizeof(key));
+      return true;
+    }
+    ctx->cache_misses++;
+  }
+
+  if (!logos_parse(ctx, source, length)) {
+    return false;
+  }
+  ctx->output_path = graph_filename(ctx->graph, &ctx->options);
+  memcpy(ctx->key, key, sizeof(key));
+  return ctx->output_path != NULL;
+}
+
+bool logos_prepare_file(logos_ctx_t* ctx, const char* path) {
+  if (strcmp(path, "-") != 0 && is_graph_binary(path)) {
+    if (!logos_load_binary(ctx, path)) {
+      return false;
+    }
+    ctx->output_path = graph_filename(ctx->graph, &ctx->options);
+    return ctx->output_path != NULL;
+  }
+  source_t source;
+  if (!read_source(path, &source, ctx->errors)) {
+    clear_prepared(ctx);
+    free_graph(ctx->graph);
+    ctx->graph = NULL;
+    return false;
+  }
+  bool prepared = logos_prepare_source(ctx, source.text, source.length);
+  free_source(&source);
+  return prepared;
+}
+
+const char* logos_output_path(const logos_ctx_t* ctx) {
+  return ctx->output_path;
+}
+
+bool logos_render_prepared(logos_ctx_t* ctx) {
+  if (ctx->output_path == NULL) {
+    fprintf(ctx->errors, "No graph to draw.\n");
+    return false;
+  }
+  if (ctx->cached) {
+    return cache_fetch(ctx->cache_dir, ctx->key, ctx->output_path, ctx->errors);
+  }
+  return lay_out(ctx) && render_through_private_file(ctx, ctx->output_path, ctx->key);
+}
+
+bool logos_render_source(logos_ctx_t* ctx, const char* source, size_t length) {
+  return logos_prepare_source(ctx, source, length) && logos_render_prepared(ctx);
+}
+
+bool logos_render_file(logos_ctx_t* ctx, const char* path) {
+  return logos_prepare_file(ctx, path) && logos_render_prepared(ctx);
+}
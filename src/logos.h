@@ -0,0 +1,112 @@
+#ifndef LOGOS_H
+#define LOGOS_H
+
+// Public interface for using logos as a library. (liblogos.a, which exports nothing but the logos_* functions)
+// Everything that goes from a source to a drawing lives in a context and nothing is global, so
+// contexts can be used on as many threads at once as needed. (each context by one thread at a time)
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Logos context, one per diagram being worked on. (opaque, see logos.c)
+typedef struct logos_ctx logos_ctx_t;
+// Thread pool for parsing and layout work, contexts can share one. (opaque)
+typedef struct logos_pool logos_pool_t;
+
+// Output file formats.
+typedef enum {
+  LOGOS_FORMAT_SVG, // (default)
+  LOGOS_FORMAT_PNG
+} logos_format_t;
+
+// Layout algorithms.
+typedef enum {
+  LOGOS_LAYOUT_TREE,    // Tidy tree of each node's parent/children. (default)
+  LOGOS_LAYOUT_LAYERED, // Layered drawing for graphs that aren't trees.
+  LOGOS_LAYOUT_FORCE    // Force directed drawing for graphs without any hierarchy.
+} logos_layout_t;
+
+// Creates context with the default options. Returns NULL if memory allocation failed.
+logos_ctx_t* logos_create(void);
+// Creates context with the same options as ctx (error stream, pool and cache directory included), without its
+// graph. Returns NULL if memory allocation failed.
+logos_ctx_t* logos_clone(const logos_ctx_t* ctx);
+// Frees context and its graph. (not the pool)
+void logos_free(logos_ctx_t* ctx);
+
+// Creates pool that runs work on threads threads, counting the thread that hands it out. Returns NULL if
+// threads <= 1 or they couldn't be started, contexts given NULL do all of their work on the calling thread.
+logos_pool_t* logos_pool_create(int threads);
+// Returns number of online cpus. (at least 1)
+int logos_cpu_count(void);
+// Stops the pool's threads and frees it. (pool can be NULL)
+void logos_pool_free(logos_pool_t* pool);
+
+// Sets where errors and warnings are printed. (stderr unless changed)
+void logos_set_errors(logos_ctx_t* ctx, FILE* errors);
+// Sets the background color, any svg color name, hex or rgb value. (borrowed, "white" unless changed)
+void logos_set_background_color(logos_ctx_t* ctx, const char* color);
+// Sets the node color, any svg color name, hex or rgb value. (borrowed, "white" unless changed)
+void logos_set_node_color(logos_ctx_t* ctx, const char* color);
+// Sets the text size in pixels.
+void logos_set_text_size(logos_ctx_t* ctx, int size);
+// Sets the output format. (svg unless changed)
+void logos_set_format(logos_ctx_t* ctx, logos_format_t format);
+// Sets the layout. (tree unless changed)
+void logos_set_layout(logos_ctx_t* ctx, logos_layout_t layout);
+// Sets the compression level: 0-9 writes gzip compressed svg (.svgz), -1 plain svg. (png: deflate level, -1 for
+// the default) -1 unless changed.
+void logos_set_compression(logos_ctx_t* ctx, int level);
+// Sets the pool parsing and layout work runs on, NULL to do it all on the calling thread. (borrowed, NULL unless
+// changed)
+void logos_set_pool(logos_ctx_t* ctx, logos_pool_t* pool);
+// Sets where logos_render_source caches outputs (see cache.h), NULL to not cache. (borrowed, NULL unless changed)
+void logos_set_cache_dir(logos_ctx_t* ctx, const char* dir);
+// Returns how many outputs logos_render_source found in the cache.
+int logos_cache_hits(const logos_ctx_t* ctx);
+// Returns how many outputs logos_render_source had to draw with a cache directory set.
+int logos_cache_misses(const logos_ctx_t* ctx);
+
+// Parses the first length chars of source into ctx's graph, replacing the previous one.
+// source[length] has to be a '\0'. Lexer, parser and variables only live for the call.
+// Returns false (after printing the errors) if the source had errors.
+bool logos_parse(logos_ctx_t* ctx, const char* source, size_t length);
+// Same as logos_parse with the contents of the file at path. (standard input if path is "-")
+bool logos_parse_file(logos_ctx_t* ctx, const char* path);
+// Prints ctx's graph to standard output, for debugging.
+void logos_print_graph(const logos_ctx_t* ctx);
+// Loads the binary graph at path (written by logos_save_binary) into ctx, replacing the previous graph.
+// It is already laid out, so rendering it skips parsing and layout. Returns false (after printing why) if it failed.
+bool logos_load_binary(logos_ctx_t* ctx, const char* path);
+// Lays out ctx's graph (unless it already is) and writes it to path in the binary graph format. (see binary.h)
+// Returns false (after printing why) if there is no graph or it couldn't be written.
+bool logos_save_binary(logos_ctx_t* ctx, const char* path);
+// Lays out (unless it already is) and draws ctx's graph to path, or to "<title>.svg" (".svgz", ".png") in the
+// working directory if path is NULL. Returns false (after printing why) if there is no graph or it couldn't be drawn.
+bool logos_render(logos_ctx_t* ctx, const char* path);
+// Parses, lays out and draws the first length chars of source to "<title>.svg" (".svgz", ".png") like the logos
+// command. With a cache directory set, the output is looked up there first by a hash of source and the options,
+// skipping all of that when found (ctx's graph is then cleared), and stored there when drawn. Outputs are drawn to a
+// private file next to the output first and renamed over it when done, so the cache stores exactly what was drawn.
+// Returns false (after printing why) if the source had errors or the output couldn't be drawn.
+bool logos_render_source(logos_ctx_t* ctx, const char* source, size_t length);
+// Same as logos_render_source with the contents of the file at path. (standard input if path is "-")
+// Binary graphs (see binary.h) are drawn as they are, without the cache.
+bool logos_render_file(logos_ctx_t* ctx, const char* path);
+
+// logos_render_source and logos_render_file in two steps, so callers drawing many outputs can see where each one
+// goes before anything is written.
+// Does everything logos_render_source does before writing: finds the output in the cache or parses the source.
+// Returns false (after printing why) if the source had errors.
+bool logos_prepare_source(logos_ctx_t* ctx, const char* source, size_t length);
+// Same as logos_prepare_source with the contents of the file at path, binary graphs are loaded instead.
+bool logos_prepare_file(logos_ctx_t* ctx, const char* path);
+// Returns the path the prepared output is drawn to, NULL if nothing is prepared. (owned by ctx, until the next
+// parse, load or prepare)
+const char* logos_output_path(const logos_ctx_t* ctx);
+// Draws the prepared output to logos_output_path, or puts it back from the cache.
+// Returns false (after printing why) if nothing is prepared or it couldn't be drawn.
+bool logos_render_prepared(logos_ctx_t* ctx);
+
+#endif
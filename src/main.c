@@ -1,71 +1,241 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include <stdbool.h>
-#include "graph.h"
-#include "lexer.h"
-#include "parser.h"
-#include "svg.h"
+#include <stdint.h>
+#include "logos.h"
+#include "deflate.h"
+#include "source.h"
+#include "binary.h"
+#include "pool.h"
+#include "table.h"
 
 #define VERSION "1.0.0"
 #define DEBUG_MODE false
 
-// Reads file from path and returns source text.
-static char* read_file(const char* path) {
-  FILE* file = fopen(path, "rb");
-  // Couldn't open file, most likely due to improper path.
-  if (file == NULL) {
-    fprintf(stderr, "Could not open file \"%s\".\n", path);
-    exit(74);
+// Read file (or standard input if path is "-"), interpret, and draw graph if successful.
+// Binary graphs (from --emit-bin) are drawn as they are. The graph is also written to emit_path if given.
+// Otherwise the output may come from the cache, if there is one.
+static void run_file(const char* path, const char* emit_path, logos_ctx_t* ctx) {
+  if (strcmp(path, "-") != 0 && is_graph_binary(path)) {
+    if (!logos_load_binary(ctx, path)) {
+      exit(74);
+    }
+  } else {
+    source_t source;
+    if (!read_source(path, &source, stderr)) {
+      exit(74);
+    }
+    if (emit_path == NULL) {
+      logos_render_source(ctx, source.text, source.length);
+      free_source(&source);
+      return;
+    }
+    bool parsed = logos_parse(ctx, source.text, source.length);
+    free_source(&source);
+    if (!parsed) {
+      return;
+    }
   }
 
-  fseek(file, 0L, SEEK_END);
-  size_t file_size = ftell(file);
-  rewind(file);
-
-  char* buffer = malloc(file_size + 1);
-  if (buffer == NULL) {
-    fprintf(stderr, "Not enough memory to read \"%s\".\n", path);
+  #if DEBUG_MODE
+    logos_print_graph(ctx);
+  #endif
+  if (emit_path != NULL) {
+    logos_save_binary(ctx, emit_path);
   }
+  logos_render(ctx, NULL);
+}
+
+// One input of a batch.
+typedef struct {
+  const char* path;
+  logos_ctx_t* ctx; // Holds it from being prepared until it is drawn. (NULL if that couldn't be created)
+  FILE* stream;     // Where ctx prints, into errors. (NULL if it couldn't be opened, ctx then prints to stderr)
+  bool ok;
+  bool cache_hit;
+  char* errors; // Errors and warnings printed while drawing it. (NULL if none could be kept)
+  size_t errors_length;
+} batch_file_t;
 
-  size_t bytes_read = fread(buffer, sizeof(char), file_size, file);
-  // Something went wrong when reading the file.
-  if (bytes_read < file_size) {
-    fprintf(stderr, "Could not read file \"%s\".\n", path);
-    exit(74);
+// Inputs of a batch and the context whose options they are all drawn with.
+typedef struct {
+  batch_file_t* files;
+  const logos_ctx_t* options;
+} batch_t;
+
+// Task preparing one input of a batch with a context of its own, so where it is drawn to is known.
+static void prepare_batch_file(void* context, int index) {
+  batch_t* batch = context;
+  batch_file_t* file = &batch->files[index];
+  file->ctx = logos_clone(batch->options);
+  if (file->ctx == NULL) {
+    fprintf(stderr, "Memory allocation failed for context.\n");
+    return;
+  }
+  // Kept in memory so each file's errors are reported together, whatever the other threads print.
+  file->stream = open_memstream(&file->errors, &file->errors_length);
+  if (file->stream != NULL) {
+    logos_set_errors(file->ctx, file->stream);
   }
+  file->ok = logos_prepare_file(file->ctx, file->path);
+  file->cache_hit = logos_cache_hits(file->ctx) > 0;
+}
 
-  buffer[bytes_read] = '\0';
+// Task drawing one prepared input of a batch.
+static void render_batch_file(void* context, int index) {
+  batch_t* batch = context;
+  batch_file_t* file = &batch->files[index];
+  if (file->ok) {
+    file->ok = logos_render_prepared(file->ctx);
+  }
+  if (file->stream != NULL) {
+    fclose(file->stream);
+  }
+  logos_free(file->ctx);
+}
 
-  fclose(file);
-  return buffer;
+// Helper to fail every input drawn to the same path as an earlier one, so which of them ends up there doesn't
+// depend on how the threads run. Returns false if memory allocation failed.
+static bool refuse_shared_outputs(batch_file_t* files, int count) {
+  table_t* outputs = create_table(); // Output path -> index of the first input drawn to it + 1.
+  if (outputs == NULL) {
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    if (!files[i].ok) {
+      continue;
+    }
+    const char* output = logos_output_path(files[i].ctx);
+    intptr_t first = (intptr_t)table_get(outputs, output);
+    if (first != 0) {
+      fprintf(files[i].stream != NULL ? files[i].stream : stderr,
+              "Output \"%s\" is already drawn from \"%s\", give one of them another title.\n", output,
+              files[first - 1].path);
+      files[i].ok = false;
+    } else if (table_set(outputs, output, (void*)(intptr_t)(i + 1)) == NULL) {
+      free_table(outputs);
+      return false;
+    }
+  }
+  free_table(outputs);
+  return true;
 }
 
-// Read file, interpret, and draw graph if successful.
-static void run_file(const char* path, char* bg_color, char* node_color, int text_size) {
-  char* source = read_file(path);
+// Draws every one of count paths with options' options on pool, then reports which failed and why.
+// Returns false if any did.
+static bool run_batch(char** paths, int count, const logos_ctx_t* options, pool_t* pool, bool cached) {
+  batch_file_t* files = calloc(count, sizeof(batch_file_t));
+  if (files == NULL) {
+    fprintf(stderr, "Memory allocation failed for batch.\n");
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    files[i].path = paths[i];
+  }
+  batch_t batch = { .files = files, .options = options };
+  // Inputs are handed out to the pool's threads as they free up. Parsing and layout inside each use the same
+  // pool, so a few big inputs still keep every thread busy.
+  // Every input is parsed (or found in the cache) before any is drawn, since outputs are named by titles and two
+  // inputs drawn to the same file at once would each overwrite the other.
+  pool_run(pool, prepare_batch_file, &batch, count);
+  if (!refuse_shared_outputs(files, count)) {
+    fprintf(stderr, "Memory allocation failed for batch.\n");
+    for (int i = 0; i < count; i++) {
+      files[i].ok = false;
+    }
+  }
+  pool_run(pool, render_batch_file, &batch, count);
 
-  init_parser(source);
-  interpret_result_t result = interpret();
+  int failed = 0;
+  int hits = 0;
+  for (int i = 0; i < count; i++) {
+    batch_file_t* file = &files[i];
+    if (!file->ok || file->errors_length > 0) {
+      fprintf(stderr, "%s: %s\n", file->path, file->ok ? "drawn with warnings" : "failed");
+      if (file->errors_length > 0) {
+        fwrite(file->errors, 1, file->errors_length, stderr);
+      }
+    }
+    failed += !file->ok;
+    hits += file->ok && file->cache_hit;
+    free(file->errors);
+  }
+  printf("Batch: %d file%s, %d drawn, %d failed\n", count, count == 1 ? "" : "s", count - failed, failed);
+  if (cached) {
+    printf("Cache: %d hit%s, %d miss%s\n", hits, hits == 1 ? "" : "s", count - hits, count - hits == 1 ? "" : "es");
+  }
+  free(files);
+  return failed == 0;
+}
 
-  if (!result.had_error) {
-  #if DEBUG_MODE
-    print_graph(result.graph);
-  #endif
-    draw_graph(result.graph, bg_color, node_color, text_size);
+// Adds a copy of the first length chars of path to paths, growing it if needed.
+// Returns false (after printing why) if memory allocation failed.
+static bool add_path(char*** paths, int* count, int* capacity, const char* path, size_t length) {
+  if (*count == *capacity) {
+    int new_capacity = *capacity * 2;
+    char** grown = realloc(*paths, sizeof(char*) * new_capacity);
+    if (grown == NULL) {
+      fprintf(stderr, "Memory allocation failed for batch.\n");
+      return false;
+    }
+    *paths = grown;
+    *capacity = new_capacity;
   }
+  char* copy = strndup(path, length);
+  if (copy == NULL) {
+    fprintf(stderr, "Memory allocation failed for batch.\n");
+    return false;
+  }
+  (*paths)[(*count)++] = copy;
+  return true;
+}
 
-  free_graph(result.graph);
-  free(source);
+// Adds every line of the manifest at path (one input path per line, blank lines skipped) to paths.
+// Returns false (after printing why) if it couldn't be read.
+static bool read_manifest(const char* path, char*** paths, int* count, int* capacity) {
+  source_t manifest;
+  if (!read_source(path, &manifest, stderr)) {
+    return false;
+  }
+  const char* line = manifest.text;
+  const char* end = manifest.text + manifest.length;
+  while (line < end) {
+    const char* newline = memchr(line, '\n', end - line);
+    const char* line_end = newline != NULL ? newline : end;
+    size_t length = line_end - line;
+    if (length > 0 && line[length - 1] == '\r') {
+      length--;
+    }
+    if (length > 0 && !add_path(paths, count, capacity, line, length)) {
+      free_source(&manifest);
+      return false;
+    }
+    line = line_end + 1;
+  }
+  free_source(&manifest);
+  return true;
 }
 
 // Prints help info.
 void print_help() {
   printf("Usage: logos <path> [...options]\n");
+  printf("       logos --batch <path>... [...options]\n");
+  printf("  <path> can be - to read from standard input.\n");
   printf("Options:\n");
+  printf("  --batch                           Draw every <path> given in one process, on --threads threads\n");
+  printf("  --manifest <file>                 Draw every path listed in file (one per line), implies --batch\n");
   printf("  -bgc, --background-color <color>  Set the background color (default: white)\n");
   printf("  -nc, --node-color <color>         Set the node color (default: white)\n");
   printf("  -ts, --text-size <size>           Set the text size (default: 16)\n");
+  printf("  -f, --format <svg|png>            Set the output format (default: svg)\n");
+  printf("  -l, --layout <tree|layered|force> Set the layout, layered and force handle graphs that aren't trees (default: tree)\n");
+  printf("  --emit-bin <file>                 Also write the laid out graph to file, drawn again as <path> without parsing\n");
+  printf("  --cache <dir>                     Reuse outputs of unchanged sources and options from dir, storing new ones there\n");
+  printf("  --threads <count>                 Set the number of threads used for layout (default: number of cpus)\n");
+  printf("  -z, --compress                    Write gzip compressed svg (.svgz)\n");
+  printf("  --compression-level <0-9>         Set the compression level, implies --compress (default: 6)\n");
   printf("  --version                         Show the version information\n");
   printf("  --help                            Show this help message\n");
   printf("\nFor more help please visit: https://github.com/yari-dewalt/logos\n");
@@ -77,10 +247,20 @@ int main(int argc, char* argv[]) {
     exit(64);
   }
 
-  char* path = NULL;
-  char* bg_color = "white";
-  char* node_color = "white";
-  int text_size = 24;
+  // Inputs, one unless drawing a batch. (copies, so manifest lines and arguments are freed the same way)
+  int num_paths = 0;
+  int paths_capacity = argc;
+  char** paths = malloc(sizeof(char*) * paths_capacity);
+  bool batch = false;
+  char* emit_path = NULL;
+  char* cache_dir = NULL;
+  logos_ctx_t* ctx = logos_create();
+  if (ctx == NULL || paths == NULL) {
+    fprintf(stderr, "Memory allocation failed for context.\n");
+    exit(70);
+  }
+  int compress_level = -1;
+  int threads = logos_cpu_count();
 
   for (int i = 1; i < argc; i++) {
     if (strcmp(argv[i], "--version") == 0) {
@@ -89,15 +269,67 @@ int main(int argc, char* argv[]) {
     } else if (strcmp(argv[i], "--help") == 0) {
       print_help(); // Print help and don't run.
       exit(0);
-    } else if (i == 1) {
-      path = argv[i]; // Path is always first argument.
+    } else if (strcmp(argv[i], "--batch") == 0) {
+      batch = true;
+    } else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) {
+      batch = true;
+      if (!read_manifest(argv[++i], &paths, &num_paths, &paths_capacity)) {
+        exit(74);
+      }
+    } else if (i == 1 || (batch && (argv[i][0] != '-' || strcmp(argv[i], "-") == 0))) {
+      // Path is always first argument, a batch can have more after it.
+      if (!add_path(&paths, &num_paths, &paths_capacity, argv[i], strlen(argv[i]))) {
+        exit(70);
+      }
     // Option parsing.
     } else if ((strcmp(argv[i], "-bgc") == 0 || strcmp(argv[i], "--background-color") == 0) && i + 1 < argc) {
-      bg_color = argv[++i];
+      logos_set_background_color(ctx, argv[++i]);
     } else if ((strcmp(argv[i], "-nc") == 0 || strcmp(argv[i], "--node-color") == 0) && i + 1 < argc) {
-      node_color = argv[++i];
+      logos_set_node_color(ctx, argv[++i]);
     } else if ((strcmp(argv[i], "-ts") == 0 || strcmp(argv[i], "--text-size") == 0) && i + 1 < argc) {
-      text_size = atoi(argv[++i]);
+      logos_set_text_size(ctx, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "-z") == 0 || strcmp(argv[i], "--compress") == 0) {
+      if (compress_level < 0) compress_level = DEFLATE_DEFAULT_LEVEL;
+    } else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--format") == 0) && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "svg") == 0) {
+        logos_set_format(ctx, LOGOS_FORMAT_SVG);
+      } else if (strcmp(argv[i], "png") == 0) {
+        logos_set_format(ctx, LOGOS_FORMAT_PNG);
+      } else {
+        fprintf(stderr, "Unknown format: %s (expected svg or png)\n", argv[i]);
+        exit(64);
+      }
+    } else if (strncmp(argv[i], "--layout=", 9) == 0 ||
+               ((strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--layout") == 0) && i + 1 < argc)) {
+      // Both "--layout layered" and "--layout=layered".
+      const char* layout = strncmp(argv[i], "--layout=", 9) == 0 ? argv[i] + 9 : argv[++i];
+      if (strcmp(layout, "tree") == 0) {
+        logos_set_layout(ctx, LOGOS_LAYOUT_TREE);
+      } else if (strcmp(layout, "layered") == 0) {
+        logos_set_layout(ctx, LOGOS_LAYOUT_LAYERED);
+      } else if (strcmp(layout, "force") == 0) {
+        logos_set_layout(ctx, LOGOS_LAYOUT_FORCE);
+      } else {
+        fprintf(stderr, "Unknown layout: %s (expected tree, layered or force)\n", layout);
+        exit(64);
+      }
+    } else if (strcmp(argv[i], "--emit-bin") == 0 && i + 1 < argc) {
+      emit_path = argv[++i];
+    } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+      cache_dir = argv[++i];
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+      if (threads < 1) {
+        fprintf(stderr, "Thread count must be at least 1.\n");
+        exit(64);
+      }
+    } else if (strcmp(argv[i], "--compression-level") == 0 && i + 1 < argc) {
+      compress_level = atoi(argv[++i]);
+      if (compress_level < 0 || compress_level > 9) {
+        fprintf(stderr, "Compression level must be from 0 to 9.\n");
+        exit(64);
+      }
     } else {
       fprintf(stderr, "Unknown option: %s\n", argv[i]);
       printf("Usage: logos <path> [...options]\n");
@@ -105,12 +337,36 @@ int main(int argc, char* argv[]) {
     }
   }
 
-  if (path == NULL) {
+  if (num_paths == 0) {
     fprintf(stderr, "Error: <path> is required.\n");
     printf("Usage: logos <path> [...options]\n");
     exit(64);
   }
+  if (batch && emit_path != NULL) {
+    fprintf(stderr, "Error: --emit-bin draws one graph, it can't be used with --batch.\n");
+    exit(64);
+  }
 
-  run_file(path, bg_color, node_color, text_size);
-  return 0;
+  int status = 0;
+  logos_pool_t* pool = logos_pool_create(threads);
+  logos_set_compression(ctx, compress_level);
+  logos_set_pool(ctx, pool);
+  logos_set_cache_dir(ctx, cache_dir);
+  if (batch) {
+    status = run_batch(paths, num_paths, ctx, pool, cache_dir != NULL) ? 0 : 65;
+  } else {
+    run_file(paths[0], emit_path, ctx);
+    if (cache_dir != NULL) {
+      int hits = logos_cache_hits(ctx);
+      int misses = logos_cache_misses(ctx);
+      printf("Cache: %d hit%s, %d miss%s\n", hits, hits == 1 ? "" : "s", misses, misses == 1 ? "" : "es");
+    }
+  }
+  logos_free(ctx);
+  logos_pool_free(pool);
+  for (int i = 0; i < num_paths; i++) {
+    free(paths[i]);
+  }
+  free(paths);
+  return status;
 }
@@ -1,375 +1,636 @@
 #include "parser.h"
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
-// Globals...but this way don't have to pass around parser and interpret_result everywhere.
-interpret_result_t interpret_result;
-parser_t parser;
+// Sources are split into chunks of about this many bytes when there is a pool to parse them on.
+#define CHUNK_SIZE (1 << 20)
+#define MAX_CHUNKS 256
 
-// Reports an error at the token.
-static void error_at(token token, const char* message) {
+// What a statement does, in the order the statement does it. a and b are indices into the chunk's symbols
+// (or strings), line is where the statement's error would be.
+typedef enum {
+  EVENT_ERROR,        // Syntax or lexer error, a is the index into errors.
+  EVENT_TITLE,        // Title set to string b.
+  EVENT_DECLARE,      // Symbol a declared as string b.
+  EVENT_DECLARE_COPY, // Symbol a declared as symbol b's value, b has to be declared.
+  EVENT_USE,          // Symbol a has to be declared. (where an arrow chain starts)
+  EVENT_EDGE,         // Edge from symbol a to symbol b, b has to be declared.
+  EVENT_DOUBLE_EDGE,  // Edges both ways between symbols a and b, b has to be declared.
+  EVENT_SYNCHRONIZE   // The statement had an error and the parser skipped to the end of its line.
+} event_type;
+
+// Set on an event's type when its line ends after it.
+#define EVENT_LINE_END 0x80
+
+struct event {
+  uint8_t type;
+  int line;
+  int a;
+  int b;
+};
+
+// A distinct name in a chunk.
+struct symbol {
+  const char* start;
+  int length;
+  struct variable* variable; // Cached once the name is declared, while replaying.
+};
+
+// A title or value, still in the source.
+struct string {
+  const char* start;
+  int length;
+};
+
+struct parse_error {
+  token token;
+  const char* message;
+};
+
+// A declared variable, the values of the replay's variables. (keyed by name)
+typedef struct variable {
+  const char* name;
+  const char* value;
+  int node; // Its node, -1 until an edge uses it.
+} variable_t;
+
+// Helper to make room for one more item in array, doubling its capacity.
+static bool reserve_one(void** array, int count, int* capacity, size_t size) {
+  if (count < *capacity) {
+    return true;
+  }
+  int new_capacity = *capacity == 0 ? 64 : *capacity * 2;
+  void* grown = realloc(*array, size * new_capacity);
+  if (grown == NULL) {
+    return false;
+  }
+  *array = grown;
+  *capacity = new_capacity;
+  return true;
+}
+
+// Records an event, returns its index (-1 if memory allocation failed).
+static int add_event(parser_t* parser, event_type type, int line, int a, int b) {
+  if (!reserve_one((void**)&parser->events, parser->num_events, &parser->events_capacity, sizeof(struct event))) {
+    parser->out_of_memory = true;
+    return -1;
+  }
+  parser->events[parser->num_events] = (struct event){ .type = type, .line = line, .a = a, .b = b };
+  return parser->num_events++;
+}
+
+// Reports an error at the token. (recorded, it is printed when the events are replayed)
+static void error_at(parser_t* parser, token token, const char* message) {
   // If we are already in panic mode we don't report anymore errors until we are out of it.
-  if (parser.panic_mode) return;
+  if (parser->panic_mode) return;
   // Set panic mode to on.
-  parser.panic_mode = true;
-  fprintf(stderr, "[line %d] Error", token.line);
+  parser->panic_mode = true;
 
-  if (token.type == TOKEN_EOF) {
-    fprintf(stderr, " at end");
-  } else if (token.type == TOKEN_ERROR) {
-    // Nothing.
-  } else {
-    fprintf(stderr, " at '%.*s'", token.length, token.start);
+  if (!reserve_one((void**)&parser->errors, parser->num_errors, &parser->errors_capacity,
+                   sizeof(struct parse_error))) {
+    parser->out_of_memory = true;
+    return;
   }
-
-  fprintf(stderr, ": %s\n", message);
-  // Error flags so we know we had error when parsing / interpreting.
-  parser.had_error = true;
-  interpret_result.had_error = true;
+  parser->errors[parser->num_errors] = (struct parse_error){ .token = token, .message = message };
+  add_event(parser, EVENT_ERROR, token.line, parser->num_errors++, 0);
 }
 
 // Easy helper to report error at current.
-static void error(const char* message) {
-  error_at(parser.curr, message);
+static void error(parser_t* parser, const char* message) {
+  error_at(parser, parser->curr, message);
 }
 
 // Scans and goes to next token. Updates curr and next.
-void next_token() {
-  parser.curr = parser.next;
+static void next_token(parser_t* parser) {
+  parser->curr = parser->next;
+  // Lexer errors are reported once the token after them is current, so they come in source order with the
+  // parser's errors (and the same way at the start of a chunk as in the middle of one).
+  if (parser->next_error.type == TOKEN_ERROR) {
+    token lexer_error = parser->next_error;
+    parser->next_error.type = TOKEN_EOF;
+    error_at(parser, lexer_error, lexer_error.start);
+  }
 
   for (;;) {
-    parser.next = scan_token(parser.lexer);
-    if (parser.next.type != TOKEN_ERROR) break;
+    parser->next = scan_token(parser->lexer);
+    if (parser->next.type != TOKEN_ERROR) break;
 
-    error_at(parser.next, parser.next.start);
+    // Only the first counts, reporting it puts the parser in panic mode.
+    if (parser->next_error.type != TOKEN_ERROR) {
+      parser->next_error = parser->next;
+    }
   }
 }
 
-static void init_interpret_result() {
-  interpret_result.graph = create_graph();
-  interpret_result.had_error = false;
+// Frees memory used by parser.
+static void free_parser(parser_t* parser) {
+  free(parser->lexer);
+  if (parser->names != NULL) {
+    free_table(parser->names);
+  }
+  free(parser->symbols);
+  free(parser->strings);
+  free(parser->events);
+  free(parser->errors);
+  parser->lexer = NULL;
+  parser->names = NULL;
+  parser->symbols = NULL;
+  parser->strings = NULL;
+  parser->events = NULL;
+  parser->errors = NULL;
 }
 
-void init_parser(const char* source) {
-  init_interpret_result();
-  parser.lexer = init_lexer(source);
-  parser.variables = create_table();
-  parser.had_error = false;
-  parser.panic_mode = false;
-  next_token();
-  next_token();
+// Initializes parser over the first length chars of source. Returns false if memory allocation failed.
+static bool init_parser(parser_t* parser, const char* source, size_t length) {
+  memset(parser, 0, sizeof(parser_t));
+  parser->lexer = init_lexer(source, length);
+  parser->names = create_table();
+  if (parser->lexer == NULL || parser->names == NULL) {
+    free_parser(parser);
+    return false;
+  }
+  parser->next.type = TOKEN_EOF;
+  parser->next_error.type = TOKEN_EOF;
+  next_token(parser);
+  next_token(parser);
+  return true;
 }
 
 // Returns if current token type matches specified type.
-bool check_token(token_type type) {
-  return type == parser.curr.type;
+static bool check_token(parser_t* parser, token_type type) {
+  return type == parser->curr.type;
 }
 
 // Returns if next token type matches specified type.
-bool check_peek(token_type type) {
-  return type == parser.next.type;
+static bool check_peek(parser_t* parser, token_type type) {
+  return type == parser->next.type;
 }
 
-// If current token type matches type move on, else return.
-void match(token_type type) {
-  if (!check_token(type)) return;
-  next_token();
+// Skips newline tokens until it finds not a newline token, marking where lines end.
+static void new_line(parser_t* parser) {
+  while (check_token(parser, TOKEN_NEWLINE)) {
+    if (parser->num_events > 0) {
+      parser->events[parser->num_events - 1].type |= EVENT_LINE_END;
+    }
+    next_token(parser);
+  }
 }
 
-// Skips newline tokens until it finds not a newline token.
-static void new_line() {
-  match(TOKEN_NEWLINE);
-  while (check_token(TOKEN_NEWLINE)) {
-    next_token();
+// Returns the index of the current token's name in the chunk's symbols, adding it the first time.
+// (-1 if memory allocation failed)
+static int current_symbol(parser_t* parser) {
+  token name = parser->curr;
+  intptr_t index = (intptr_t)table_get_n(parser->names, name.start, name.length);
+  if (index != 0) {
+    return (int)index - 1;
   }
-}
 
-// Checks if variable is declared.
-static bool is_declared(const char* key) {
-  return table_get(parser.variables, key) != NULL;
+  if (!reserve_one((void**)&parser->symbols, parser->num_symbols, &parser->symbols_capacity,
+                   sizeof(struct symbol)) ||
+      table_set_n(parser->names, name.start, name.length, (void*)(intptr_t)(parser->num_symbols + 1)) == NULL) {
+    parser->out_of_memory = true;
+    return -1;
+  }
+  parser->symbols[parser->num_symbols] = (struct symbol){ .start = name.start, .length = name.length };
+  return parser->num_symbols++;
 }
 
-// Declares variable and puts its name and value into variable table.
-static void declare_variable(const char* name, char* value) {
-  table_set(parser.variables, name, value);
-  node_t* node = get_node(interpret_result.graph, name);
-  if (node != NULL) {
-    // Update the node's text if the node has already been defined.
-    node->text = value;
+// Returns the index of the current token's text in the chunk's strings. (-1 if memory allocation failed)
+static int current_string(parser_t* parser) {
+  if (!reserve_one((void**)&parser->strings, parser->num_strings, &parser->strings_capacity,
+                   sizeof(struct string))) {
+    parser->out_of_memory = true;
+    return -1;
   }
+  parser->strings[parser->num_strings] = (struct string){ .start = parser->curr.start, .length = parser->curr.length };
+  return parser->num_strings++;
 }
 
-// Adds edge to graph between two nodes.
-static void add_edge_to_graph(const char* from, const char* to) {
-  if (!add_edge(interpret_result.graph, from, to)) {
-    error("Invalid nodes for edge creation.");
-  }
+// Helper to check for either arrow as the next token.
+static bool peek_arrow(parser_t* parser) {
+  return check_peek(parser, TOKEN_ARROW) || check_peek(parser, TOKEN_DOUBLE_ARROW);
 }
 
-static void assignment(char* prev_name, bool add_edge, bool add_two_edges);
+// Arrow statement parsing, for chains like A -> B <-> C = "Inline" -> D.
+// from is the symbol the chain starts at when it was just declared inline (curr is then the first arrow),
+// -1 when curr is the identifier it starts at. Links are parsed in a loop, so chains of any length take
+// constant stack. Ends on the last target (or its inline value).
+static void arrow(parser_t* parser, int from) {
+  if (from == -1) {
+    from = current_symbol(parser);
+    add_event(parser, EVENT_USE, parser->curr.line, from, 0);
+    next_token(parser);
+  }
 
-// Arrow statement parsing.
-static void arrow(char* prev_name) {
-  // Get name.
-  char* name = strndup(parser.curr.start, parser.curr.length);
-  if (!is_declared(name) && !prev_name)
-    error("Undefined variable.");
-
-  // prev_name from inline or chaining.
-  if (prev_name)
-    name = prev_name;
-  if (!prev_name) next_token();
-  if (check_token(TOKEN_ARROW)) {
+  while (check_token(parser, TOKEN_ARROW) || check_token(parser, TOKEN_DOUBLE_ARROW)) {
+    event_type edge = check_token(parser, TOKEN_DOUBLE_ARROW) ? EVENT_DOUBLE_EDGE : EVENT_EDGE;
     // Skip past arrow.
-    next_token();
-    // Get target's name
-    char* target_name = strndup(parser.curr.start, parser.curr.length);
-    if (check_token(TOKEN_IDENTIFIER)) {
-      if (check_peek(TOKEN_EQUAL)) {
-        // Chained assignment.
-        assignment(name, true, false);
-      } else if (check_peek(TOKEN_ARROW)) {
-        // Chained arrow.
-        // Subject to change but works for now.
-        if (!get_node(interpret_result.graph, name)) {
-          char* variable_value = table_get(parser.variables, name);
-          add_node(interpret_result.graph, name, variable_value);
-        }
-        if (is_declared(target_name)) {
-          char* variable_value = table_get(parser.variables, target_name);
-          if (!get_node(interpret_result.graph, target_name))
-            add_node(interpret_result.graph, target_name, variable_value);
-          // Add edge.
-          add_edge_to_graph(name, target_name);
-        }
-        arrow(NULL);
-      } else if (check_peek(TOKEN_DOUBLE_ARROW)) {
-        // Chained double arrow.
-        // Subject to change but works for now.
-        if (!get_node(interpret_result.graph, name)) {
-          char* variable_value = table_get(parser.variables, name);
-          add_node(interpret_result.graph, name, variable_value);
-        }
-        if (is_declared(target_name)) {
-          char* variable_value = table_get(parser.variables, target_name);
-          if (!get_node(interpret_result.graph, target_name))
-            add_node(interpret_result.graph, target_name, variable_value);
-          // Add double edge.
-          add_edge_to_graph(name, target_name);
-          add_edge_to_graph(target_name, name);
-        }
-        arrow(NULL);
-      }
-      // Create node if needed.
-      if (!get_node(interpret_result.graph, name)) {
-        char* variable_value = table_get(parser.variables, name);
-        add_node(interpret_result.graph, name, variable_value);
-      }
-      if (is_declared(target_name)) {
-        // If declared, add edge.
-        char* variable_value = table_get(parser.variables, target_name);
-        // Add node if the node doesn't exist already.
-        if (!get_node(interpret_result.graph, target_name))
-          add_node(interpret_result.graph, target_name, variable_value);
-        add_edge_to_graph(name, target_name);
-      } else {
-        error("Undefined variable.");
-      }
-    }
-    else {
-      error("Expected identifier.");
+    next_token(parser);
+    if (!check_token(parser, TOKEN_IDENTIFIER)) {
+      error(parser, "Expected identifier.");
+      return;
     }
-  } else if (check_token(TOKEN_DOUBLE_ARROW)) {
-    // Same logic as regular arrow, but will add double edge.
-    next_token();
-    char* target_name = strndup(parser.curr.start, parser.curr.length);
-    if (check_token(TOKEN_IDENTIFIER)) {
-      if (check_peek(TOKEN_EQUAL)) {
-        assignment(name, false, true);
-      } else if (check_peek(TOKEN_ARROW)) {
-        // This works for now but keep eye on it. ----
-        if (!get_node(interpret_result.graph, name)) {
-          char* variable_value = table_get(parser.variables, name);
-          add_node(interpret_result.graph, name, variable_value);
-        }
-        if (is_declared(target_name)) {
-          char* variable_value = table_get(parser.variables, target_name);
-          if (!get_node(interpret_result.graph, target_name))
-            add_node(interpret_result.graph, target_name, variable_value);
-          add_edge_to_graph(name, target_name);
-        }
-        // ------
-        arrow(NULL);
-      } else if (check_peek(TOKEN_DOUBLE_ARROW)) {
-        if (!get_node(interpret_result.graph, name)) {
-          char* variable_value = table_get(parser.variables, name);
-          add_node(interpret_result.graph, name, variable_value);
-        }
-        if (is_declared(target_name)) {
-          char* variable_value = table_get(parser.variables, target_name);
-          if (!get_node(interpret_result.graph, target_name))
-            add_node(interpret_result.graph, target_name, variable_value);
-          add_edge_to_graph(name, target_name);
-          add_edge_to_graph(target_name, name);
-        }
-        arrow(NULL);
-      }
-      if (!get_node(interpret_result.graph, name)) {
-        char* variable_value = table_get(parser.variables, name);
-        add_node(interpret_result.graph, name, variable_value);
+
+    int to = current_symbol(parser);
+    int line = parser->curr.line;
+    if (check_peek(parser, TOKEN_EQUAL)) {
+      // Inline declaration of the target.
+      next_token(parser);
+      next_token(parser);
+      if (check_token(parser, TOKEN_IDENTIFIER)) {
+        error(parser, "Cannot assign to identifier while adding edge.");
+        return;
+      } else if (!check_token(parser, TOKEN_STRING)) {
+        error(parser, "Expected string or identifier.");
+        return;
       }
-      if (is_declared(target_name)) {
-        char* variable_value = table_get(parser.variables, target_name);
-        if (!get_node(interpret_result.graph, target_name))
-          add_node(interpret_result.graph, target_name, variable_value);
-        add_edge_to_graph(name, target_name);
-        add_edge_to_graph(target_name, name);
-      } else {
-        error("Undefined variable.");
+      add_event(parser, EVENT_DECLARE, line, to, current_string(parser));
+      add_event(parser, edge, line, from, to);
+      if (check_peek(parser, TOKEN_EQUAL)) {
+        // String is followed by equal sign.
+        error(parser, "Cannot assign to literal.");
+        next_token(parser);
+        next_token(parser);
+        return;
       }
+    } else {
+      add_event(parser, edge, line, from, to);
     }
-    else {
-      error("Expected identifier.");
+
+    // Chained arrow, the target is where the next link starts.
+    if (!peek_arrow(parser)) {
+      return;
     }
+    next_token(parser);
+    from = to;
   }
 }
 
-// Assignment parsing.
-static void assignment(char* prev_name, bool add_edge, bool add_two_edges) {
+// Assignment parsing, curr is the name being declared.
+static void assignment(parser_t* parser) {
   // Get name.
-  char* name = strndup(parser.curr.start, parser.curr.length);
-  // Inline but not inline with arrows.
-  if (prev_name && !add_edge && !add_two_edges)
-    name = prev_name;
-  if (!prev_name || add_edge || add_two_edges) next_token();
-  if (check_token(TOKEN_EQUAL)) {
-    // Move past equal sign.
-    next_token();
-    // Get value.
-    char* value = strndup(parser.curr.start, parser.curr.length);
-
-    if (check_token(TOKEN_STRING)) {
-      // Assign to string.
-      declare_variable(name, value);
-      // Inline with arrow.
-      if (add_edge) {
-        if (!get_node(interpret_result.graph, prev_name)) {
-          value = table_get(parser.variables, prev_name);
-          add_node(interpret_result.graph, prev_name, value);
-        }
-        if (!get_node(interpret_result.graph, name)) {
-          value = table_get(parser.variables, name);
-          add_node(interpret_result.graph, name, value);
-        }
-        add_edge_to_graph(prev_name, name);
-      // Inline with double arrow.
-      } else if (add_two_edges) {
-        if (!get_node(interpret_result.graph, prev_name)) {
-          value = table_get(parser.variables, prev_name);
-          add_node(interpret_result.graph, prev_name, value);
-        }
-        if (!get_node(interpret_result.graph, name)) {
-          value = table_get(parser.variables, name);
-          add_node(interpret_result.graph, name, value);
-        }
-        add_edge_to_graph(prev_name, name);
-        add_edge_to_graph(name, prev_name);
-      }
-      if (check_peek(TOKEN_EQUAL)) {
-        // String is followed by equal sign.
-        error("Cannot assign to literal.");
-        next_token();
-        next_token();
-      } else if (check_peek(TOKEN_ARROW) || check_peek(TOKEN_DOUBLE_ARROW)) {
-        // Inline with arrows.
-        next_token();
-        arrow(name);
-      } else {
-        next_token();
-      }
-    } else if (check_token(TOKEN_IDENTIFIER)) {
-      // Inline with arrow.
-      if (add_edge || add_two_edges) {
-        error("Cannot assign to identifier while adding edge.");
-      }
-      if (check_peek(TOKEN_EQUAL)) {
-        // Chained assignment.
-        assignment(NULL, false, false);
-      } else if (check_peek(TOKEN_ARROW) || check_peek(TOKEN_DOUBLE_ARROW)) {
-        arrow(NULL);
-      }
-      // Get value of identifier and assign.
-      char* variable_value = table_get(parser.variables, value);
-      if (variable_value != NULL) declare_variable(name, variable_value);
-      else {
-        error("Undefined variable.");
-      }
-    } else {
-      error("Expected string or identifier.");
+  int name = current_symbol(parser);
+  next_token(parser);
+  if (!check_token(parser, TOKEN_EQUAL)) {
+    return;
+  }
+  // Move past equal sign.
+  next_token(parser);
+
+  if (check_token(parser, TOKEN_STRING)) {
+    // Assign to string.
+    add_event(parser, EVENT_DECLARE, parser->curr.line, name, current_string(parser));
+    if (check_peek(parser, TOKEN_EQUAL)) {
+      // String is followed by equal sign.
+      error(parser, "Cannot assign to literal.");
+      next_token(parser);
+      next_token(parser);
+    } else if (peek_arrow(parser)) {
+      // Inline with arrows.
+      next_token(parser);
+      arrow(parser, name);
+    }
+  } else if (check_token(parser, TOKEN_IDENTIFIER)) {
+    int value = current_symbol(parser);
+    int line = parser->curr.line;
+    if (check_peek(parser, TOKEN_EQUAL)) {
+      // Chained assignment.
+      assignment(parser);
+    } else if (peek_arrow(parser)) {
+      arrow(parser, -1);
     }
+    // Assign the value of the identifier (once whatever follows it is done).
+    add_event(parser, EVENT_DECLARE_COPY, line, name, value);
+  } else {
+    error(parser, "Expected string or identifier.");
   }
 }
 
 // Synchronize from panic mode so we don't report chain of errors.
-static void synchronize() {
-  parser.panic_mode = false;
-  // Move to next line.
-  while (parser.next.type != TOKEN_EOF) {
-    if (parser.curr.type == TOKEN_NEWLINE) return;
-    next_token();
+// Statements never go past a newline, so this skips the rest of the failed statement's line.
+static void synchronize(parser_t* parser) {
+  while (!check_token(parser, TOKEN_EOF) && !check_token(parser, TOKEN_NEWLINE)) {
+    next_token(parser);
   }
+  parser->panic_mode = false;
+  add_event(parser, EVENT_SYNCHRONIZE, parser->curr.line, 0, 0);
 }
 
 // Statement parsing, either title, assignment, or arrow.
-static void statement() {
-  if (check_token(TOKEN_LEFT_BRACE)) {
-    next_token();
-    if (check_token(TOKEN_STRING)) {
-      char* title = strndup(parser.curr.start, parser.curr.length);
-      update_graph_title(interpret_result.graph, title);
-      next_token();
-      if (check_token(TOKEN_RIGHT_BRACE)) {
-        next_token();
+static void statement(parser_t* parser) {
+  if (check_token(parser, TOKEN_LEFT_BRACE)) {
+    next_token(parser);
+    if (check_token(parser, TOKEN_STRING)) {
+      add_event(parser, EVENT_TITLE, parser->curr.line, 0, current_string(parser));
+      next_token(parser);
+      if (check_token(parser, TOKEN_RIGHT_BRACE)) {
+        next_token(parser);
       }
     } else {
-      error("Expected string.");
+      error(parser, "Expected string.");
     }
   }
 
-  else if (check_token(TOKEN_IDENTIFIER)) {
+  else if (check_token(parser, TOKEN_IDENTIFIER)) {
     // Identifier gets either assigned or points to another identifier.
-    if (check_peek(TOKEN_EQUAL)) {
-      assignment(NULL, false, false);
-      next_token();
+    if (check_peek(parser, TOKEN_EQUAL)) {
+      assignment(parser);
+      if (!parser->panic_mode) next_token(parser);
     }
-    else if (check_peek(TOKEN_ARROW) || check_peek(TOKEN_DOUBLE_ARROW)) {
-      arrow(NULL);
-      next_token();
+    else if (peek_arrow(parser)) {
+      arrow(parser, -1);
+      if (!parser->panic_mode) next_token(parser);
     }
     else {
-      error("Expected either assignment or arrow to node.");
+      error(parser, "Expected either assignment or arrow to node.");
     }
   }
 
-  new_line();
+  else if (!check_token(parser, TOKEN_NEWLINE)) {
+    error(parser, "Expected title, assignment or arrow.");
+  }
 }
 
 // Loops through and parses all tokens.
-void parse() {
-  while (check_token(TOKEN_NEWLINE)) {
-    next_token();
+static void parse(parser_t* parser) {
+  new_line(parser);
+  while (!check_token(parser, TOKEN_EOF)) {
+    statement(parser);
+    if (parser->panic_mode) synchronize(parser);
+    new_line(parser);
+  }
+}
+
+// Replay state, carried over from one chunk to the next.
+typedef struct {
+  interpret_result_t result;
+  FILE* errors;       // Where errors are printed.
+  table_t* variables; // Declared names to their variable_t.
+  bool panic_mode;
+  bool skip_line;     // A name was undefined, and parsing would have stopped there until the end of the line.
+} replay_t;
+
+// Prints an error at token (with its line moved by line_offset), unless already in panic mode.
+static void report_error(replay_t* replay, token token, int line_offset, const char* message) {
+  if (replay->panic_mode) return;
+  replay->panic_mode = true;
+  fprintf(replay->errors, "[line %d] Error", token.line + line_offset);
+
+  if (token.type == TOKEN_EOF) {
+    fprintf(replay->errors, " at end");
+  } else if (token.type == TOKEN_NEWLINE) {
+    fprintf(replay->errors, " at end of line");
+  } else if (token.type == TOKEN_ERROR) {
+    // Nothing.
+  } else {
+    fprintf(replay->errors, " at '%.*s'", token.length, token.start);
+  }
+
+  fprintf(replay->errors, ": %s\n", message);
+  // Error flag so we know we had error when parsing / interpreting.
+  replay->result.had_error = true;
+}
+
+// Helper to report an error at a symbol used on line.
+static void symbol_error(replay_t* replay, struct symbol* symbol, int line, int line_offset, const char* message) {
+  token at = { .type = TOKEN_IDENTIFIER, .start = symbol->start, .length = symbol->length, .line = line };
+  report_error(replay, at, line_offset, message);
+}
+
+// Returns the variable the symbol names, NULL if it isn't declared (yet).
+static variable_t* resolve(replay_t* replay, struct symbol* symbol) {
+  if (symbol->variable == NULL) {
+    symbol->variable = table_get_n(replay->variables, symbol->start, symbol->length);
+  }
+  return symbol->variable;
+}
+
+// Declares symbol's variable (or changes its value), updating its node's text if it has one.
+static bool declare_variable(replay_t* replay, struct symbol* symbol, const char* value) {
+  graph_t* graph = replay->result.graph;
+  variable_t* variable = resolve(replay, symbol);
+  if (variable == NULL) {
+    variable = arena_alloc(graph->arena, sizeof(variable_t));
+    const char* name = intern(graph->strings, symbol->start, symbol->length);
+    if (variable == NULL || name == NULL || table_set(replay->variables, name, variable) == NULL) {
+      return false;
+    }
+    variable->name = name;
+    variable->node = -1;
+    symbol->variable = variable;
   }
+  variable->value = value;
+  // Update the node's text if the node has already been defined.
+  return variable->node == -1 || set_node_text(graph, variable->node, value);
+}
 
-  while (!check_token(TOKEN_EOF)) {
-    statement();
-    if (parser.panic_mode) synchronize();
+// Returns the variable's node, adding it to the graph the first time an edge uses it. (-1 if that failed)
+static int variable_node(replay_t* replay, variable_t* variable) {
+  if (variable->node == -1) {
+    variable->node = add_node(replay->result.graph, variable->name, variable->value);
   }
+  return variable->node;
+}
+
+// Adds edge to graph between two variables' nodes, and one back for a double arrow.
+static bool add_edge_to_graph(replay_t* replay, variable_t* from, variable_t* to, bool double_edge) {
+  graph_t* graph = replay->result.graph;
+  int from_node = variable_node(replay, from);
+  int to_node = variable_node(replay, to);
+  return add_edge_ids(graph, from_node, to_node) && (!double_edge || add_edge_ids(graph, to_node, from_node));
+}
+
+// Applies a chunk's events to the graph, checking names as they are used. line_offset is the number of
+// lines before the chunk.
+static void replay_chunk(replay_t* replay, parser_t* parser, int line_offset) {
+  graph_t* graph = replay->result.graph;
+  for (int i = 0; i < parser->num_events; i++) {
+    struct event* event = &parser->events[i];
+    event_type type = event->type & ~EVENT_LINE_END;
+    // Which of these an event's a and b index depends on its type.
+    struct symbol* a = parser->symbols + event->a;
+    struct symbol* b = parser->symbols + event->b;
+    struct string* string = parser->strings + event->b;
+
+    switch (replay->skip_line ? EVENT_SYNCHRONIZE : type) {
+      case EVENT_ERROR: {
+        struct parse_error* error = &parser->errors[event->a];
+        report_error(replay, error->token, line_offset, error->message);
+        break;
+      }
+      case EVENT_TITLE:
+        if (!replay->panic_mode) {
+          const char* title = intern(graph->strings, string->start, string->length);
+          if (title != NULL) {
+            update_graph_title(graph, title);
+          }
+        }
+        break;
+      case EVENT_DECLARE:
+        if (!replay->panic_mode && !declare_variable(replay, a, intern(graph->strings, string->start, string->length))) {
+          symbol_error(replay, a, event->line, line_offset, "Not enough memory to declare variable.");
+        }
+        break;
+      case EVENT_DECLARE_COPY: {
+        variable_t* value = resolve(replay, b);
+        if (value == NULL) {
+          symbol_error(replay, b, event->line, line_offset, "Undefined variable.");
+          replay->skip_line = true;
+        } else if (!replay->panic_mode && !declare_variable(replay, a, value->value)) {
+          symbol_error(replay, a, event->line, line_offset, "Not enough memory to declare variable.");
+        }
+        break;
+      }
+      case EVENT_USE:
+        if (resolve(replay, a) == NULL) {
+          symbol_error(replay, a, event->line, line_offset, "Undefined variable.");
+          replay->skip_line = true;
+        }
+        break;
+      case EVENT_EDGE:
+      case EVENT_DOUBLE_EDGE: {
+        variable_t* to = resolve(replay, b);
+        if (to == NULL) {
+          symbol_error(replay, b, event->line, line_offset, "Undefined variable.");
+          replay->skip_line = true;
+        } else if (!replay->panic_mode &&
+                   !add_edge_to_graph(replay, resolve(replay, a), to, type == EVENT_DOUBLE_EDGE)) {
+          symbol_error(replay, b, event->line, line_offset, "Invalid nodes for edge creation.");
+        }
+        break;
+      }
+      case EVENT_SYNCHRONIZE:
+        if (!replay->skip_line) {
+          replay->panic_mode = false;
+        }
+        break;
+    }
+
+    if (event->type & EVENT_LINE_END) {
+      replay->panic_mode = false;
+      replay->skip_line = false;
+    }
+  }
+}
+
+// Chunks of the source being parsed.
+typedef struct {
+  const char* source;
+  size_t* offsets; // Chunk i is source[offsets[i]] up to source[offsets[i + 1]].
+  parser_t* parsers;
+} chunks_t;
+
+// Task parsing one chunk.
+static void parse_chunk(void* context, int index) {
+  chunks_t* c = context;
+  parser_t* parser = &c->parsers[index];
+  if (!init_parser(parser, c->source + c->offsets[index], c->offsets[index + 1] - c->offsets[index])) {
+    parser->out_of_memory = true;
+    return;
+  }
+  parse(parser);
+}
+
+// Helper to split source into count chunks that each end after a newline (the last one at the end).
+static void split_source(const char* source, size_t length, int count, size_t* offsets) {
+  offsets[0] = 0;
+  for (int i = 1; i < count; i++) {
+    size_t start = length / count * i;
+    if (start < offsets[i - 1]) {
+      start = offsets[i - 1];
+    }
+    const char* newline = memchr(source + start, '\n', length - start);
+    offsets[i] = newline != NULL ? (size_t)(newline - source) + 1 : length;
+  }
+  offsets[count] = length;
+}
+
+// Helper to parse source in count chunks (on pool's threads). Returns false if memory allocation failed,
+// or a chunk other than the last ended inside a comment (so the split was in the middle of one).
+static bool parse_chunks(const char* source, size_t length, int count, pool_t* pool, chunks_t* chunks) {
+  chunks->source = source;
+  chunks->offsets = malloc(sizeof(size_t) * (count + 1));
+  chunks->parsers = calloc(count, sizeof(parser_t));
+  if (chunks->offsets == NULL || chunks->parsers == NULL) {
+    return false;
+  }
+  split_source(source, length, count, chunks->offsets);
+  pool_run(pool, parse_chunk, chunks, count);
+
+  for (int i = 0; i < count; i++) {
+    parser_t* parser = &chunks->parsers[i];
+    if (parser->out_of_memory || (i < count - 1 && parser->lexer->open_comment)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Helper to free chunks' parsers.
+static void free_chunks(chunks_t* chunks, int count) {
+  if (chunks->parsers != NULL) {
+    for (int i = 0; i < count; i++) {
+      free_parser(&chunks->parsers[i]);
+    }
+  }
+  free(chunks->parsers);
+  free(chunks->offsets);
+  chunks->parsers = NULL;
+  chunks->offsets = NULL;
 }
 
 // Returns the overall interpret result.
-interpret_result_t interpret() {
-  parse();
-  return interpret_result;
+interpret_result_t interpret(const char* source, size_t length, pool_t* pool, FILE* errors) {
+  replay_t replay = { .result = { .had_error = false, .graph = create_graph() }, .errors = errors };
+  replay.variables = create_table();
+  if (replay.result.graph != NULL) {
+    replay.result.graph->errors = errors;
+  }
+  if (replay.result.graph == NULL || replay.variables == NULL) {
+    fprintf(errors, "Memory allocation failed for parser.\n");
+    replay.result.had_error = true;
+    if (replay.variables != NULL) {
+      free_table(replay.variables);
+    }
+    return replay.result;
+  }
+
+  // Source ends at the first '\0', like it always has.
+  length = strnlen(source, length);
+  int count = 1;
+  if (pool != NULL && length / CHUNK_SIZE > 1) {
+    count = length / CHUNK_SIZE < MAX_CHUNKS ? (int)(length / CHUNK_SIZE) : MAX_CHUNKS;
+  }
+
+  chunks_t chunks = { 0 };
+  bool parsed = parse_chunks(source, length, count, pool, &chunks);
+  if (!parsed && count > 1) {
+    // A "/* */" comment spans chunks (or memory ran out), go over the source in one piece.
+    free_chunks(&chunks, count);
+    count = 1;
+    parsed = parse_chunks(source, length, count, pool, &chunks);
+  }
+
+  if (!parsed) {
+    fprintf(errors, "Memory allocation failed for parser.\n");
+    replay.result.had_error = true;
+  } else {
+    // Names can be declared in any earlier chunk, so events are replayed in source order.
+    int line_offset = 0;
+    for (int i = 0; i < count; i++) {
+      replay_chunk(&replay, &chunks.parsers[i], line_offset);
+      line_offset += chunks.parsers[i].lexer->line - 1;
+    }
+  }
+  free_chunks(&chunks, count);
+  free_table(replay.variables);
+
+  // Levels are only known once every edge is in.
+  if (!replay.result.had_error && !assign_levels(replay.result.graph)) {
+    replay.result.had_error = true;
+  }
+  return replay.result;
 }
@@ -2,9 +2,12 @@
 #define PARSER_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
 #include "lexer.h"
 #include "table.h"
 #include "graph.h"
+#include "pool.h"
 
 // Interpret result representation.
 typedef struct {
@@ -12,29 +15,35 @@ typedef struct {
   graph_t* graph;
 } interpret_result_t;
 
-// Parser struct
+// Parser struct, one per chunk of the source. (see parser.c for the events, symbols and errors)
+// Parsing only checks syntax and records what the statements do as events. Names are resolved when
+// interpret replays every chunk's events in source order, since a chunk can use names declared in earlier ones.
 typedef struct {
   lexer_t* lexer;
   token curr;
   token next;
-  table_t* variables;
-  bool had_error;
+  token next_error;       // First lexer error before next, reported once next is current. (TOKEN_EOF if none)
   bool panic_mode;
+  bool out_of_memory;
+  table_t* names;         // Name (not null terminated, in the source) to its index in symbols + 1.
+  struct symbol* symbols; // Distinct names in the chunk.
+  int num_symbols;
+  int symbols_capacity;
+  struct string* strings; // Titles and values.
+  int num_strings;
+  int strings_capacity;
+  struct event* events;
+  int num_events;
+  int events_capacity;
+  struct parse_error* errors;
+  int num_errors;
+  int errors_capacity;
 } parser_t;
 
-// Initializes global parser. (doesn't return pointer)
-void init_parser(const char* source);
-// Scans and goes to next token.
-void next_token();
-// Checks current token type.
-bool check_token(token_type type);
-// Checks next token type.
-bool check_peek(token_type type);
-// Consumes current token if type matches, else returns.
-void match(token_type type);
-// Loop to parse all tokens.
-void parse();
-// Calls parse and returns the interpret result.
-interpret_result_t interpret();
+// Parses the first length chars of source (followed by a '\0') into a graph and returns the interpret result.
+// Big sources are split on line boundaries and the chunks are parsed on pool's threads (pool can be NULL).
+// Errors are the same, with the same line numbers, however the source is split. They are printed to errors, which
+// the graph also keeps for its warnings.
+interpret_result_t interpret(const char* source, size_t length, pool_t* pool, FILE* errors);
 
 #endif
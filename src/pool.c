@@ -0,0 +1,153 @@
+#include "pool.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// One pool_run call.
+typedef struct job {
+  pool_task task;
+  void* context;
+  int count;
+  int next;             // Next index to hand out.
+  int done;             // Indices finished.
+  struct job* next_job; // Next job that still has indices to hand out.
+} job_t;
+
+struct logos_pool {
+  pthread_t* threads;
+  int num_threads;
+  pthread_mutex_t lock;
+  pthread_cond_t work;     // Signaled when jobs are added or the pool stops.
+  pthread_cond_t finished; // Signaled when a job's last index is done.
+  job_t* jobs;             // Jobs with indices left to hand out.
+  bool stopping;
+};
+
+int pool_cpu_count(void) {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int)count : 1;
+}
+
+// Helper to take the next index of job, removing it from the list once all are handed out. (lock held)
+static int take_index(pool_t* pool, job_t* job) {
+  int index = job->next++;
+  if (job->next == job->count) {
+    job_t** link = &pool->jobs;
+    while (*link != job) {
+      link = &(*link)->next_job;
+    }
+    *link = job->next_job;
+  }
+  return index;
+}
+
+// Helper to run index of job and count it as done. (lock held, released while the task runs)
+static void run_index(pool_t* pool, job_t* job, int index) {
+  pthread_mutex_unlock(&pool->lock);
+  job->task(job->context, index);
+  pthread_mutex_lock(&pool->lock);
+  job->done++;
+  if (job->done == job->count) {
+    pthread_cond_broadcast(&pool->finished);
+  }
+}
+
+// Worker thread loop, runs indices of whichever job is first in line.
+static void* worker(void* arg) {
+  pool_t* pool = arg;
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->stopping && pool->jobs == NULL) {
+      pthread_cond_wait(&pool->work, &pool->lock);
+    }
+    if (pool->jobs == NULL) {
+      break; // Stopping and nothing left.
+    }
+    job_t* job = pool->jobs;
+    run_index(pool, job, take_index(pool, job));
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+pool_t* pool_create(int num_threads) {
+  if (num_threads <= 1) {
+    return NULL;
+  }
+
+  pool_t* pool = malloc(sizeof(pool_t));
+  if (pool == NULL) {
+    return NULL;
+  }
+  // The thread calling pool_run is one of them.
+  pool->threads = malloc(sizeof(pthread_t) * (num_threads - 1));
+  if (pool->threads == NULL) {
+    free(pool);
+    return NULL;
+  }
+  pool->num_threads = 0;
+  pool->jobs = NULL;
+  pool->stopping = false;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work, NULL);
+  pthread_cond_init(&pool->finished, NULL);
+
+  for (int i = 0; i < num_threads - 1; i++) {
+    if (pthread_create(&pool->threads[i], NULL, worker, pool) != 0) {
+      fprintf(stderr, "Could not start worker thread.\n");
+      break;
+    }
+    pool->num_threads++;
+  }
+  if (pool->num_threads == 0) {
+    pool_free(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+void pool_run(pool_t* pool, pool_task task, void* context, int count) {
+  if (pool == NULL || count <= 1) {
+    for (int i = 0; i < count; i++) {
+      task(context, i);
+    }
+    return;
+  }
+
+  job_t job = { .task = task, .context = context, .count = count, .next = 0, .done = 0 };
+  pthread_mutex_lock(&pool->lock);
+  job.next_job = pool->jobs;
+  pool->jobs = &job;
+  pthread_cond_broadcast(&pool->work);
+
+  // Help out with our own job, then wait for the indices other threads took.
+  while (job.next < job.count) {
+    run_index(pool, &job, take_index(pool, &job));
+  }
+  while (job.done < job.count) {
+    pthread_cond_wait(&pool->finished, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_free(pool_t* pool) {
+  if (pool == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = true;
+  pthread_cond_broadcast(&pool->work);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 0; i < pool->num_threads; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->work);
+  pthread_cond_destroy(&pool->finished);
+  free(pool->threads);
+  free(pool);
+}
@@ -0,0 +1,21 @@
+#ifndef POOL_H
+#define POOL_H
+
+// Task run for every index of a pool_run call.
+typedef void (*pool_task)(void* context, int index);
+
+// Thread pool. (opaque, see pool.c)
+typedef struct logos_pool pool_t;
+
+// Returns number of online cpus. (at least 1)
+int pool_cpu_count(void);
+// Creates pool that runs tasks on num_threads threads, counting the thread calling pool_run.
+// Returns NULL if num_threads <= 1 or threads couldn't be started, pool_run then runs tasks on the caller.
+pool_t* pool_create(int num_threads);
+// Runs task(context, i) for i in [0, count) and returns once all of them are done.
+// The caller works on its own tasks too, so tasks may call pool_run themselves. (pool can be NULL)
+void pool_run(pool_t* pool, pool_task task, void* context, int count);
+// Stops threads and frees pool memory. (pool can be NULL)
+void pool_free(pool_t* pool);
+
+#endif
@@ -0,0 +1,796 @@
+#include "raster.h"
+#include "deflate.h"
+#include "font.h"
+#include "svg.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Shapes are filled a scanline at a time: each pixel row is sampled on SUBSAMPLES
+// sub-scanlines, the part of a span that every sub-scanline covers is filled directly
+// and only the partially covered pixels at its ends are blended.
+#define SUBSAMPLES 4
+#define PNG_IDAT_SIZE (64 * 1024)
+
+// Named svg/css color.
+typedef struct {
+  const char* name;
+  uint32_t rgb;
+} named_color_t;
+
+// Sorted by name for binary search.
+static const named_color_t NAMED_COLORS[] = {
+  { "aliceblue", 0xf0f8ff },
+  { "antiquewhite", 0xfaebd7 },
+  { "aqua", 0x00ffff },
+  { "aquamarine", 0x7fffd4 },
+  { "azure", 0xf0ffff },
+  { "beige", 0xf5f5dc },
+  { "bisque", 0xffe4c4 },
+  { "black", 0x000000 },
+  { "blanchedalmond", 0xffebcd },
+  { "blue", 0x0000ff },
+  { "blueviolet", 0x8a2be2 },
+  { "brown", 0xa52a2a },
+  { "burlywood", 0xdeb887 },
+  { "cadetblue", 0x5f9ea0 },
+  { "chartreuse", 0x7fff00 },
+  { "chocolate", 0xd2691e },
+  { "coral", 0xff7f50 },
+  { "cornflowerblue", 0x6495ed },
+  { "cornsilk", 0xfff8dc },
+  { "crimson", 0xdc143c },
+  { "cyan", 0x00ffff },
+  { "darkblue", 0x00008b },
+  { "darkcyan", 0x008b8b },
+  { "darkgoldenrod", 0xb8860b },
+  { "darkgray", 0xa9a9a9 },
+  { "darkgreen", 0x006400 },
+  { "darkgrey", 0xa9a9a9 },
+  { "darkkhaki", 0xbdb76b },
+  { "darkmagenta", 0x8b008b },
+  { "darkolivegreen", 0x556b2f },
+  { "darkorange", 0xff8c00 },
+  { "darkorchid", 0x9932cc },
+  { "darkred", 0x8b0000 },
+  { "darksalmon", 0xe9967a },
+  { "darkseagreen", 0x8fbc8f },
+  { "darkslateblue", 0x483d8b },
+  { "darkslategray", 0x2f4f4f },
+  { "darkslategrey", 0x2f4f4f },
+  { "darkturquoise", 0x00ced1 },
+  { "darkviolet", 0x9400d3 },
+  { "deeppink", 0xff1493 },
+  { "deepskyblue", 0x00bfff },
+  { "dimgray", 0x696969 },
+  { "dimgrey", 0x696969 },
+  { "dodgerblue", 0x1e90ff },
+  { "firebrick", 0xb22222 },
+  { "floralwhite", 0xfffaf0 },
+  { "forestgreen", 0x228b22 },
+  { "fuchsia", 0xff00ff },
+  { "gainsboro", 0xdcdcdc },
+  { "ghostwhite", 0xf8f8ff },
+  { "gold", 0xffd700 },
+  { "goldenrod", 0xdaa520 },
+  { "gray", 0x808080 },
+  { "green", 0x008000 },
+  { "greenyellow", 0xadff2f },
+  { "grey", 0x808080 },
+  { "honeydew", 0xf0fff0 },
+  { "hotpink", 0xff69b4 },
+  { "indianred", 0xcd5c5c },
+  { "indigo", 0x4b0082 },
+  { "ivory", 0xfffff0 },
+  { "khaki", 0xf0e68c },
+  { "lavender", 0xe6e6fa },
+  { "lavenderblush", 0xfff0f5 },
+  { "lawngreen", 0x7cfc00 },
+  { "lemonchiffon", 0xfffacd },
+  { "lightblue", 0xadd8e6 },
+  { "lightcoral", 0xf08080 },
+  { "lightcyan", 0xe0ffff },
+  { "lightgoldenrodyellow", 0xfafad2 },
+  { "lightgray", 0xd3d3d3 },
+  { "lightgreen", 0x90ee90 },
+  { "lightgrey", 0xd3d3d3 },
+  { "lightpink", 0xffb6c1 },
+  { "lightsalmon", 0xffa07a },
+  { "lightseagreen", 0x20b2aa },
+  { "lightskyblue", 0x87cefa },
+  { "lightslategray", 0x778899 },
+  { "lightslategrey", 0x778899 },
+  { "lightsteelblue", 0xb0c4de },
+  { "lightyellow", 0xffffe0 },
+  { "lime", 0x00ff00 },
+  { "limegreen", 0x32cd32 },
+  { "linen", 0xfaf0e6 },
+  { "magenta", 0xff00ff },
+  { "maroon", 0x800000 },
+  { "mediumaquamarine", 0x66cdaa },
+  { "mediumblue", 0x0000cd },
+  { "mediumorchid", 0xba55d3 },
+  { "mediumpurple", 0x9370db },
+  { "mediumseagreen", 0x3cb371 },
+  { "mediumslateblue", 0x7b68ee },
+  { "mediumspringgreen", 0x00fa9a },
+  { "mediumturquoise", 0x48d1cc },
+  { "mediumvioletred", 0xc71585 },
+  { "midnightblue", 0x191970 },
+  { "mintcream", 0xf5fffa },
+  { "mistyrose", 0xffe4e1 },
+  { "moccasin", 0xffe4b5 },
+  { "navajowhite", 0xffdead },
+  { "navy", 0x000080 },
+  { "oldlace", 0xfdf5e6 },
+  { "olive", 0x808000 },
+  { "olivedrab", 0x6b8e23 },
+  { "orange", 0xffa500 },
+  { "orangered", 0xff4500 },
+  { "orchid", 0xda70d6 },
+  { "palegoldenrod", 0xeee8aa },
+  { "palegreen", 0x98fb98 },
+  { "paleturquoise", 0xafeeee },
+  { "palevioletred", 0xdb7093 },
+  { "papayawhip", 0xffefd5 },
+  { "peachpuff", 0xffdab9 },
+  { "peru", 0xcd853f },
+  { "pink", 0xffc0cb },
+  { "plum", 0xdda0dd },
+  { "powderblue", 0xb0e0e6 },
+  { "purple", 0x800080 },
+  { "rebeccapurple", 0x663399 },
+  { "red", 0xff0000 },
+  { "rosybrown", 0xbc8f8f },
+  { "royalblue", 0x4169e1 },
+  { "saddlebrown", 0x8b4513 },
+  { "salmon", 0xfa8072 },
+  { "sandybrown", 0xf4a460 },
+  { "seagreen", 0x2e8b57 },
+  { "seashell", 0xfff5ee },
+  { "sienna", 0xa0522d },
+  { "silver", 0xc0c0c0 },
+  { "skyblue", 0x87ceeb },
+  { "slateblue", 0x6a5acd },
+  { "slategray", 0x708090 },
+  { "slategrey", 0x708090 },
+  { "snow", 0xfffafa },
+  { "springgreen", 0x00ff7f },
+  { "steelblue", 0x4682b4 },
+  { "tan", 0xd2b48c },
+  { "teal", 0x008080 },
+  { "thistle", 0xd8bfd8 },
+  { "tomato", 0xff6347 },
+  { "turquoise", 0x40e0d0 },
+  { "violet", 0xee82ee },
+  { "wheat", 0xf5deb3 },
+  { "white", 0xffffff },
+  { "whitesmoke", 0xf5f5f5 },
+  { "yellow", 0xffff00 },
+  { "yellowgreen", 0x9acd32 },
+};
+
+// Helper to pack rgba bytes into a pixel.
+static uint32_t pack_rgba(uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+  return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+// Helper to compare color name to named color for bsearch.
+static int compare_color_name(const void* key, const void* element) {
+  return strcasecmp((const char*)key, ((const named_color_t*)element)->name);
+}
+
+// Helper to parse a rgb()/rgba() component, clamped to 0-255. (percentages allowed)
+static bool parse_component(const char** p, double scale, uint32_t* value) {
+  char* end;
+  double v = strtod(*p, &end);
+  if (end == *p) {
+    return false;
+  }
+  if (*end == '%') {
+    v = v * 255.0 / 100.0;
+    end++;
+  } else {
+    v *= scale;
+  }
+  v = v < 0 ? 0 : v > 255 ? 255 : v;
+  *value = (uint32_t)(v + 0.5);
+
+  while (isspace((unsigned char)*end) || *end == ',') end++;
+  *p = end;
+  return true;
+}
+
+// Parses svg color (name, #hex, rgb(), rgba()) into rgba. Returns false if the color isn't known.
+bool raster_parse_color(const char* color, uint32_t* rgba) {
+  while (isspace((unsigned char)*color)) color++;
+
+  if (color[0] == '#') {
+    const char* hex = color + 1;
+    size_t length = strspn(hex, "0123456789abcdefABCDEF");
+    unsigned long v = strtoul(hex, NULL, 16);
+    switch (length) {
+      case 3: // #rgb
+        *rgba = pack_rgba(((v >> 8) & 0xf) * 17, ((v >> 4) & 0xf) * 17, (v & 0xf) * 17, 255);
+        return true;
+      case 4: // #rgba
+        *rgba = pack_rgba(((v >> 12) & 0xf) * 17, ((v >> 8) & 0xf) * 17, ((v >> 4) & 0xf) * 17, (v & 0xf) * 17);
+        return true;
+      case 6: // #rrggbb
+        *rgba = pack_rgba((v >> 16) & 0xff, (v >> 8) & 0xff, v & 0xff, 255);
+        return true;
+      case 8: // #rrggbbaa
+        *rgba = pack_rgba((v >> 24) & 0xff, (v >> 16) & 0xff, (v >> 8) & 0xff, v & 0xff);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  if (strncasecmp(color, "rgb", 3) == 0) {
+    const char* p = color + 3;
+    if (*p == 'a' || *p == 'A') p++;
+    while (isspace((unsigned char)*p)) p++;
+    if (*p++ != '(') {
+      return false;
+    }
+    while (isspace((unsigned char)*p)) p++;
+
+    uint32_t r, g, b, a = 255;
+    if (!parse_component(&p, 1.0, &r) || !parse_component(&p, 1.0, &g) || !parse_component(&p, 1.0, &b)) {
+      return false;
+    }
+    if (*p != ')' && !parse_component(&p, 255.0, &a)) {
+      return false;
+    }
+    *rgba = pack_rgba(r, g, b, a);
+    return true;
+  }
+
+  if (strcasecmp(color, "none") == 0 || strcasecmp(color, "transparent") == 0) {
+    *rgba = 0;
+    return true;
+  }
+
+  const named_color_t* named = bsearch(color, NAMED_COLORS, sizeof(NAMED_COLORS) / sizeof(NAMED_COLORS[0]),
+                                       sizeof(named_color_t), compare_color_name);
+  if (named == NULL) {
+    return false;
+  }
+  *rgba = pack_rgba((named->rgb >> 16) & 0xff, (named->rgb >> 8) & 0xff, named->rgb & 0xff, 255);
+  return true;
+}
+
+// Helper to get color for drawing, unknown colors draw black.
+static uint32_t color_of(const char* color) {
+  uint32_t rgba;
+  if (!raster_parse_color(color, &rgba)) {
+    return pack_rgba(0, 0, 0, 255);
+  }
+  return rgba;
+}
+
+// Returns the smallest scale text of font_size is still legible at, one pixel per row of the bitmap font. (at most 1)
+double raster_legible_scale(int font_size) {
+  return font_size > FONT_GLYPH_HEIGHT ? (double)FONT_GLYPH_HEIGHT / font_size : 1.0;
+}
+
+// Creates, initializes, and returns raster for a width x height drawing at scale pixels per unit.
+raster_t* raster_create(int width, int height, double scale) {
+  raster_t* raster = malloc(sizeof(raster_t));
+  if (raster == NULL) {
+    return NULL;
+  }
+
+  raster->scale = scale;
+  raster->width = (int)ceil(width * scale);
+  raster->height = (int)ceil(height * scale);
+  if (raster->width < 1) raster->width = 1;
+  if (raster->height < 1) raster->height = 1;
+
+  raster->pixels = calloc((size_t)raster->width * raster->height, sizeof(uint32_t));
+  raster->coverage = calloc(raster->width, sizeof(float));
+  if (raster->pixels == NULL || raster->coverage == NULL) {
+    free(raster->pixels);
+    free(raster->coverage);
+    free(raster);
+    return NULL;
+  }
+  return raster;
+}
+
+// Frees raster memory.
+void raster_free(raster_t* raster) {
+  free(raster->pixels);
+  free(raster->coverage);
+  free(raster);
+}
+
+// Helper to blend color over pixel with coverage (0-1).
+static uint32_t blend(uint32_t pixel, uint32_t color, float coverage) {
+  uint32_t alpha = (uint32_t)(coverage * (color >> 24) + 0.5f);
+  if (alpha >= 255) {
+    return color;
+  }
+
+  uint32_t result = 0;
+  for (int shift = 0; shift < 24; shift += 8) {
+    int d = (pixel >> shift) & 0xff;
+    int c = (color >> shift) & 0xff;
+    result |= (uint32_t)(d + ((c - d) * (int)alpha + 127) / 255) << shift;
+  }
+  uint32_t a = pixel >> 24;
+  result |= (a + ((255 - a) * alpha + 127) / 255) << 24;
+  return result;
+}
+
+// Helper to fill pixels [x0, x1) of row with color.
+static void fill_span(uint32_t* row, int x0, int x1, uint32_t color) {
+  int x = x0;
+  if ((color >> 24) != 255) {
+    // Translucent, has to be blended.
+    for (; x < x1; x++) {
+      row[x] = blend(row[x], color, 1.0f);
+    }
+    return;
+  }
+
+#ifdef __SSE2__
+  __m128i c = _mm_set1_epi32((int)color);
+  for (; x + 16 <= x1; x += 16) {
+    _mm_storeu_si128((__m128i*)(row + x), c);
+    _mm_storeu_si128((__m128i*)(row + x + 4), c);
+    _mm_storeu_si128((__m128i*)(row + x + 8), c);
+    _mm_storeu_si128((__m128i*)(row + x + 12), c);
+  }
+  for (; x + 4 <= x1; x += 4) {
+    _mm_storeu_si128((__m128i*)(row + x), c);
+  }
+#endif
+  for (; x < x1; x++) {
+    row[x] = color;
+  }
+}
+
+// Shape that reports its horizontal spans (up to 2, as left/right pairs) on a scanline.
+typedef int (*spans_fn)(const void* shape, double y, double spans[4]);
+
+// Helper to add coverage of span [left, right) to pixels [from, to) of the coverage row.
+static void accumulate(raster_t* raster, double left, double right, int from, int to, int* touched_left, int* touched_right) {
+  int x0 = (int)floor(left);
+  int x1 = (int)ceil(right);
+  if (x0 < from) x0 = from;
+  if (x1 > to) x1 = to;
+
+  for (int x = x0; x < x1; x++) {
+    double l = left > x ? left : x;
+    double r = right < x + 1 ? right : x + 1;
+    if (r > l) {
+      raster->coverage[x] += (float)((r - l) / SUBSAMPLES);
+    }
+  }
+  if (x0 < x1) {
+    if (x0 < *touched_left) *touched_left = x0;
+    if (x1 > *touched_right) *touched_right = x1;
+  }
+}
+
+// Helper to fill shape spanning rows top to bottom (drawing units already scaled to pixels).
+static void fill_shape(raster_t* raster, spans_fn get_spans, const void* shape, double top, double bottom, uint32_t color) {
+  if ((color >> 24) == 0) {
+    return;
+  }
+
+  int y0 = top < 0 ? 0 : (int)floor(top);
+  int y1 = bottom > raster->height ? raster->height : (int)ceil(bottom);
+  double width = raster->width;
+
+  for (int py = y0; py < y1; py++) {
+    double spans[SUBSAMPLES][4];
+    int counts[SUBSAMPLES];
+    bool same_count = true;
+    for (int s = 0; s < SUBSAMPLES; s++) {
+      counts[s] = get_spans(shape, py + (s + 0.5) / SUBSAMPLES, spans[s]);
+      // Clip to the raster.
+      for (int k = 0; k < 2 * counts[s]; k++) {
+        spans[s][k] = spans[s][k] < 0 ? 0 : spans[s][k] > width ? width : spans[s][k];
+      }
+      if (counts[s] != counts[0]) same_count = false;
+    }
+
+    // Pixels covered on every sub-scanline are filled directly.
+    int inner[2][2] = { { 0, 0 }, { 0, 0 } };
+    if (same_count) {
+      for (int k = 0; k < counts[0]; k++) {
+        double left = spans[0][2 * k];
+        double right = spans[0][2 * k + 1];
+        for (int s = 1; s < SUBSAMPLES; s++) {
+          if (spans[s][2 * k] > left) left = spans[s][2 * k];
+          if (spans[s][2 * k + 1] < right) right = spans[s][2 * k + 1];
+        }
+        inner[k][0] = (int)ceil(left);
+        inner[k][1] = (int)floor(right);
+        if (inner[k][1] < inner[k][0]) inner[k][1] = inner[k][0];
+      }
+    }
+
+    // Everything else is accumulated and blended by coverage.
+    int touched_left = raster->width;
+    int touched_right = 0;
+    for (int s = 0; s < SUBSAMPLES; s++) {
+      for (int k = 0; k < counts[s]; k++) {
+        double left = spans[s][2 * k];
+        double right = spans[s][2 * k + 1];
+        if (right <= left) continue;
+        if (same_count) {
+          accumulate(raster, left, right, 0, inner[k][0], &touched_left, &touched_right);
+          accumulate(raster, left, right, inner[k][1], raster->width, &touched_left, &touched_right);
+        } else {
+          accumulate(raster, left, right, 0, raster->width, &touched_left, &touched_right);
+        }
+      }
+    }
+
+    uint32_t* row = raster->pixels + (size_t)py * raster->width;
+    for (int k = 0; same_count && k < counts[0]; k++) {
+      fill_span(row, inner[k][0], inner[k][1], color);
+    }
+    for (int x = touched_left; x < touched_right; x++) {
+      float c = raster->coverage[x];
+      if (c > 0) {
+        row[x] = blend(row[x], color, c > 1 ? 1 : c);
+        raster->coverage[x] = 0;
+      }
+    }
+  }
+}
+
+// Rounded rectangle shape (pixels).
+typedef struct {
+  double x0, y0, x1, y1;
+  double rx, ry;
+} rounded_rect_t;
+
+// Helper to get the span of a rounded rectangle on a scanline.
+static bool rounded_rect_span(const rounded_rect_t* rect, double y, double* left, double* right) {
+  if (y < rect->y0 || y >= rect->y1 || rect->x1 <= rect->x0) {
+    return false;
+  }
+
+  double inset = 0;
+  if (rect->rx > 0 && rect->ry > 0) {
+    double dy = 0;
+    if (y < rect->y0 + rect->ry) {
+      dy = (rect->y0 + rect->ry - y) / rect->ry;
+    } else if (y > rect->y1 - rect->ry) {
+      dy = (y - (rect->y1 - rect->ry)) / rect->ry;
+    }
+    if (dy > 0) {
+      inset = rect->rx * (1 - sqrt(1 - (dy > 1 ? 1 : dy * dy)));
+    }
+  }
+
+  *left = rect->x0 + inset;
+  *right = rect->x1 - inset;
+  return *left < *right;
+}
+
+// Helper to get rounded rectangle spans for fill_shape.
+static int rounded_rect_spans(const void* shape, double y, double spans[4]) {
+  return rounded_rect_span(shape, y, &spans[0], &spans[1]) ? 1 : 0;
+}
+
+// Ring between two rounded rectangles. (stroke of a rounded rectangle)
+typedef struct {
+  rounded_rect_t outer;
+  rounded_rect_t inner;
+} ring_t;
+
+// Helper to get ring spans for fill_shape.
+static int ring_spans(const void* shape, double y, double spans[4]) {
+  const ring_t* ring = shape;
+  double left, right, inner_left, inner_right;
+  if (!rounded_rect_span(&ring->outer, y, &left, &right)) {
+    return 0;
+  }
+  if (!rounded_rect_span(&ring->inner, y, &inner_left, &inner_right)) {
+    spans[0] = left;
+    spans[1] = right;
+    return 1;
+  }
+  spans[0] = left;
+  spans[1] = inner_left;
+  spans[2] = inner_right;
+  spans[3] = right;
+  return 2;
+}
+
+// Helper to make rounded rectangle in pixels from drawing units, radii clamped to half the size.
+static rounded_rect_t make_rounded_rect(raster_t* raster, double x, double y, double width, double height, double rx, double ry) {
+  rounded_rect_t rect;
+  if (width < 0) width = 0;
+  if (height < 0) height = 0;
+  if (rx < 0) rx = 0;
+  if (ry < 0) ry = 0;
+  if (rx > width / 2) rx = width / 2;
+  if (ry > height / 2) ry = height / 2;
+
+  rect.x0 = x * raster->scale;
+  rect.y0 = y * raster->scale;
+  rect.x1 = (x + width) * raster->scale;
+  rect.y1 = (y + height) * raster->scale;
+  rect.rx = rx * raster->scale;
+  rect.ry = ry * raster->scale;
+  return rect;
+}
+
+// Convex quadrilateral shape (pixels).
+typedef struct {
+  double xs[4];
+  double ys[4];
+} quadrilateral_t;
+
+// Helper to get quad spans for fill_shape.
+static int quad_spans(const void* shape, double y, double spans[4]) {
+  const quadrilateral_t* quad = shape;
+  double left = INFINITY;
+  double right = -INFINITY;
+
+  for (int i = 0; i < 4; i++) {
+    int j = (i + 1) % 4;
+    double ya = quad->ys[i];
+    double yb = quad->ys[j];
+    if ((ya <= y && y < yb) || (yb <= y && y < ya)) {
+      double x = quad->xs[i] + (y - ya) * (quad->xs[j] - quad->xs[i]) / (yb - ya);
+      if (x < left) left = x;
+      if (x > right) right = x;
+    }
+  }
+
+  if (left >= right) {
+    return 0;
+  }
+  spans[0] = left;
+  spans[1] = right;
+  return 1;
+}
+
+// Fills background of raster.
+void raster_fill(raster_t* raster, char* fill) {
+  uint32_t color = color_of(fill);
+  for (int y = 0; y < raster->height; y++) {
+    fill_span(raster->pixels + (size_t)y * raster->width, 0, raster->width, color);
+  }
+}
+
+// Adds rectangle to raster.
+void raster_rectangle(raster_t* raster, int width, int height, int x, int y, char* fill, char* stroke,
+                      int stroke_width, int radius_x, int radius_y) {
+  rounded_rect_t rect = make_rounded_rect(raster, x, y, width, height, radius_x, radius_y);
+  fill_shape(raster, rounded_rect_spans, &rect, rect.y0, rect.y1, color_of(fill));
+
+  if (stroke_width > 0) {
+    // Stroke is centered on the rectangle's edge.
+    double half = stroke_width / 2.0;
+    ring_t ring;
+    ring.outer = make_rounded_rect(raster, x - half, y - half, width + stroke_width, height + stroke_width,
+                                   radius_x + half, radius_y + half);
+    ring.inner = make_rounded_rect(raster, x + half, y + half, width - stroke_width, height - stroke_width,
+                                   radius_x - half, radius_y - half);
+    fill_shape(raster, ring_spans, &ring, ring.outer.y0, ring.outer.y1, color_of(stroke));
+  }
+}
+
+// Helper to draw line between two points in pixels with color.
+static void draw_line(raster_t* raster, uint32_t color, double width, double x1, double y1, double x2, double y2) {
+  double dx = x2 - x1;
+  double dy = y2 - y1;
+  double length = sqrt(dx * dx + dy * dy);
+  if (length == 0 || width <= 0) {
+    return;
+  }
+
+  // Normal of the line, half the stroke width long.
+  double nx = -dy / length * width / 2;
+  double ny = dx / length * width / 2;
+  quadrilateral_t quad = {
+    { x1 + nx, x2 + nx, x2 - nx, x1 - nx },
+    { y1 + ny, y2 + ny, y2 - ny, y1 - ny },
+  };
+
+  double top = quad.ys[0];
+  double bottom = quad.ys[0];
+  for (int i = 1; i < 4; i++) {
+    if (quad.ys[i] < top) top = quad.ys[i];
+    if (quad.ys[i] > bottom) bottom = quad.ys[i];
+  }
+  fill_shape(raster, quad_spans, &quad, top, bottom, color);
+}
+
+// Adds line to raster.
+void raster_line(raster_t* raster, char* stroke, int stroke_width, int x1, int y1, int x2, int y2) {
+  double s = raster->scale;
+  draw_line(raster, color_of(stroke), stroke_width * s, x1 * s, y1 * s, x2 * s, y2 * s);
+}
+
+// Adds arrow to raster.
+void raster_arrow(raster_t* raster, char* stroke, int stroke_width, int arrow_length,
+                  int x1, int y1, int x2, int y2) {
+  uint32_t color = color_of(stroke);
+  double s = raster->scale;
+  double width = stroke_width * s;
+
+  int points[4];
+  svg_arrowhead_points(arrow_length, x1, y1, x2, y2, points);
+
+  draw_line(raster, color, width, x1 * s, y1 * s, x2 * s, y2 * s);
+  draw_line(raster, color, width, x2 * s, y2 * s, points[0] * s, points[1] * s);
+  draw_line(raster, color, width, x2 * s, y2 * s, points[2] * s, points[3] * s);
+}
+
+// Draws text centered on (x, y) with the built-in bitmap font. (font_family and stroke are ignored)
+void raster_text(raster_t* raster, int x, int y, char* font_family, int font_size, char* fill, char* stroke, const char* text) {
+  (void)font_family;
+  (void)stroke;
+  uint32_t color = color_of(fill);
+
+  // Count characters. (utf-8 sequences are one character each, drawn as '?')
+  int num_chars = 0;
+  for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+    if ((*p & 0xc0) != 0x80) num_chars++;
+  }
+  if (num_chars == 0) {
+    return;
+  }
+
+  // Glyph cell height is about one em.
+  double unit = (double)font_size / FONT_GLYPH_HEIGHT;
+  double left = x - (num_chars * FONT_ADVANCE - (FONT_ADVANCE - FONT_GLYPH_WIDTH)) * unit / 2;
+  double top = y - FONT_CAP_HEIGHT * unit / 2;
+
+  int i = 0;
+  for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+    if ((*p & 0xc0) == 0x80) continue;
+    const uint8_t* glyph = font_glyph(*p < 0x80 ? (char)*p : '?');
+    double glyph_left = left + i * FONT_ADVANCE * unit;
+
+    for (int row = 0; row < FONT_GLYPH_HEIGHT; row++) {
+      uint8_t bits = glyph[row];
+      // Draw each run of set bits as one rectangle.
+      int col = 0;
+      while (col < FONT_GLYPH_WIDTH) {
+        if (!(bits & (1 << (FONT_GLYPH_WIDTH - 1 - col)))) {
+          col++;
+          continue;
+        }
+        int run_start = col;
+        while (col < FONT_GLYPH_WIDTH && (bits & (1 << (FONT_GLYPH_WIDTH - 1 - col)))) col++;
+
+        rounded_rect_t rect;
+        rect.x0 = (glyph_left + run_start * unit) * raster->scale;
+        rect.x1 = (glyph_left + col * unit) * raster->scale;
+        rect.y0 = (top + row * unit) * raster->scale;
+        rect.y1 = (top + (row + 1) * unit) * raster->scale;
+        rect.rx = 0;
+        rect.ry = 0;
+        fill_shape(raster, rounded_rect_spans, &rect, rect.y0, rect.y1, color);
+      }
+    }
+    i++;
+  }
+}
+
+// Png writer state, compressed image data is split into IDAT chunks.
+typedef struct {
+  FILE* fp;
+  unsigned char data[PNG_IDAT_SIZE];
+  size_t length;
+} png_writer_t;
+
+// Helper to write 32 bit big endian number.
+static void write_be32(FILE* fp, uint32_t n) {
+  unsigned char bytes[4] = { n >> 24, (n >> 16) & 0xff, (n >> 8) & 0xff, n & 0xff };
+  fwrite(bytes, 1, 4, fp);
+}
+
+// Helper to write png chunk.
+static void write_chunk(FILE* fp, const char* type, const unsigned char* data, size_t length) {
+  write_be32(fp, (uint32_t)length);
+  fwrite(type, 1, 4, fp);
+  fwrite(data, 1, length, fp);
+  uint32_t crc = crc32_update(0, type, 4);
+  crc = crc32_update(crc, data, length);
+  write_be32(fp, crc);
+}
+
+// Helper sink that collects compressed bytes into IDAT chunks.
+static void idat_sink(void* context, const unsigned char* data, size_t length) {
+  png_writer_t* writer = context;
+  while (length > 0) {
+    size_t n = PNG_IDAT_SIZE - writer->length;
+    if (n > length) n = length;
+    memcpy(writer->data + writer->length, data, n);
+    writer->length += n;
+    data += n;
+    length -= n;
+    if (writer->length == PNG_IDAT_SIZE) {
+      write_chunk(writer->fp, "IDAT", writer->data, writer->length);
+      writer->length = 0;
+    }
+  }
+}
+
+// Saves raster as png file, compressed at level (0-9). Returns false if it couldn't be written.
+bool raster_save_png(raster_t* raster, const char* file_path, int level) {
+  png_writer_t* writer = malloc(sizeof(png_writer_t));
+  unsigned char* line = malloc(1 + (size_t)raster->width * 4);
+  if (writer == NULL || line == NULL) {
+    free(writer);
+    free(line);
+    return false;
+  }
+
+  writer->fp = fopen(file_path, "wb");
+  writer->length = 0;
+  if (writer->fp == NULL) {
+    free(writer);
+    free(line);
+    return false;
+  }
+
+  static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  fwrite(signature, 1, 8, writer->fp);
+
+  unsigned char header[13] = {
+    raster->width >> 24, (raster->width >> 16) & 0xff, (raster->width >> 8) & 0xff, raster->width & 0xff,
+    raster->height >> 24, (raster->height >> 16) & 0xff, (raster->height >> 8) & 0xff, raster->height & 0xff,
+    8, // Bit depth.
+    6, // Color type: rgba.
+    0, 0, 0 // Compression, filter, interlace.
+  };
+  write_chunk(writer->fp, "IHDR", header, sizeof(header));
+
+  deflate_t* compressor = deflate_create(DEFLATE_ZLIB, level, idat_sink, writer);
+  if (compressor == NULL) {
+    fclose(writer->fp);
+    free(writer);
+    free(line);
+    return false;
+  }
+
+  // Each scanline uses the Sub filter (difference to the pixel on the left),
+  // flat areas become runs of zeros which compress well.
+  for (int y = 0; y < raster->height; y++) {
+    const uint32_t* row = raster->pixels + (size_t)y * raster->width;
+    unsigned char* out = line;
+    *out++ = 1;
+    uint32_t left = 0;
+    for (int x = 0; x < raster->width; x++) {
+      uint32_t pixel = row[x];
+      for (int shift = 0; shift < 32; shift += 8) {
+        *out++ = (unsigned char)(((pixel >> shift) - (left >> shift)) & 0xff);
+      }
+      left = pixel;
+    }
+    deflate_write(compressor, line, out - line);
+  }
+  deflate_finish(compressor);
+  deflate_free(compressor);
+
+  if (writer->length > 0) {
+    write_chunk(writer->fp, "IDAT", writer->data, writer->length);
+  }
+  write_chunk(writer->fp, "IEND", NULL, 0);
+
+  bool ok = !ferror(writer->fp);
+  fclose(writer->fp);
+  free(writer);
+  free(line);
+  return ok;
+}
@@ -0,0 +1,37 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Raster image struct (same drawing api as svg_t, rendered into pixels)
+typedef struct {
+  uint32_t* pixels; // RGBA pixels, row major. (r in the lowest byte)
+  float* coverage;  // Scratch row for partially covered pixels while filling.
+  int width;        // Width in pixels.
+  int height;       // Height in pixels.
+  double scale;     // Pixels per drawing unit.
+} raster_t;
+
+// Creates, initializes, and returns raster for a width x height drawing at scale pixels per unit.
+raster_t* raster_create(int width, int height, double scale);
+// Returns the smallest scale text of font_size is still legible at, one pixel per row of the bitmap font. (at most 1)
+double raster_legible_scale(int font_size);
+// Frees raster memory.
+void raster_free(raster_t* raster);
+// Saves raster as png file, compressed at level (0-9). Returns false if it couldn't be written.
+bool raster_save_png(raster_t* raster, const char* file_path, int level);
+// Parses svg color (name, #hex, rgb(), rgba()) into rgba. Returns false if the color isn't known.
+bool raster_parse_color(const char* color, uint32_t* rgba);
+// Fills background of raster.
+void raster_fill(raster_t* raster, char* fill);
+// Adds rectangle to raster.
+void raster_rectangle(raster_t* raster, int width, int height, int x, int y, char* fill, char* stroke, int stroke_width, int radius_x, int radius_y);
+// Adds line to raster.
+void raster_line(raster_t* raster, char* stroke, int stroke_width, int x1, int y1, int x2, int y2);
+// Adds arrow to raster.
+void raster_arrow(raster_t* raster, char* stroke, int stroke_width, int arrow_length, int x1, int y1, int x2, int y2);
+// Draws text centered on (x, y) with the built-in bitmap font. (font_family and stroke are ignored)
+void raster_text(raster_t* raster, int x, int y, char* font_family, int font_size, char* fill, char* stroke, const char* text);
+
+#endif
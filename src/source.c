@@ -0,0 +1,112 @@
+#include "source.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Bytes asked for per read when streaming, the buffer doubles whenever it fills up.
+#define CHUNK_SIZE (64 * 1024)
+
+// Helper to read fd until end of input in chunks, for inputs that can't be mapped.
+static bool read_chunks(int fd, const char* name, source_t* source, FILE* errors) {
+  size_t capacity = CHUNK_SIZE;
+  size_t length = 0;
+  char* text = malloc(capacity + 1);
+  if (text == NULL) {
+    fprintf(errors, "Not enough memory to read \"%s\".\n", name);
+    return false;
+  }
+
+  for (;;) {
+    if (length == capacity) {
+      char* grown = realloc(text, capacity * 2 + 1);
+      if (grown == NULL) {
+        fprintf(errors, "Not enough memory to read \"%s\".\n", name);
+        free(text);
+        return false;
+      }
+      text = grown;
+      capacity *= 2;
+    }
+    ssize_t bytes_read = read(fd, text + length, capacity - length);
+    if (bytes_read == 0) {
+      break;
+    }
+    if (bytes_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(errors, "Could not read file \"%s\".\n", name);
+      free(text);
+      return false;
+    }
+    length += bytes_read;
+  }
+
+  text[length] = '\0';
+  source->text = text;
+  source->length = length;
+  source->mapped_length = 0;
+  return true;
+}
+
+// Helper to map size bytes of fd followed by a '\0'.
+// The mapping starts out as anonymous zeroed pages one byte bigger than the file, which the file is then
+// mapped over, so the byte after the file is always a mapped '\0' (even when size is a multiple of the page size).
+static bool map_file(int fd, size_t size, source_t* source) {
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  size_t mapped_length = (size + 1 + page_size - 1) / page_size * page_size;
+  char* text = mmap(NULL, mapped_length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (text == MAP_FAILED) {
+    return false;
+  }
+  if (mmap(text, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap(text, mapped_length);
+    return false;
+  }
+  // The lexer reads it front to back once.
+  madvise(text, size, MADV_SEQUENTIAL);
+
+  source->text = text;
+  source->length = size;
+  source->mapped_length = mapped_length;
+  return true;
+}
+
+bool read_source(const char* path, source_t* source, FILE* errors) {
+  if (strcmp(path, "-") == 0) {
+    return read_chunks(STDIN_FILENO, "<stdin>", source, errors);
+  }
+
+  int fd = open(path, O_RDONLY);
+  // Couldn't open file, most likely due to improper path.
+  if (fd == -1) {
+    fprintf(errors, "Could not open file \"%s\".\n", path);
+    return false;
+  }
+
+  struct stat info;
+  bool read = false;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    read = map_file(fd, (size_t)info.st_size, source);
+  }
+  // Pipes, empty files, or mmap failed.
+  if (!read) {
+    read = read_chunks(fd, path, source, errors);
+  }
+  close(fd);
+  return read;
+}
+
+void free_source(source_t* source) {
+  if (source->mapped_length > 0) {
+    munmap((void*)source->text, source->mapped_length);
+  } else {
+    free((void*)source->text);
+  }
+  source->text = NULL;
+}
@@ -0,0 +1,22 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Source text handed to the lexer, always followed by a '\0'.
+typedef struct {
+  const char* text;
+  size_t length;
+  size_t mapped_length; // Bytes mapped if the file is memory-mapped, 0 if text was read into memory.
+} source_t;
+
+// Reads the file at path, or standard input if path is "-".
+// Regular files are memory-mapped read-only, anything else (pipes, terminals) is read in chunks.
+// Returns false (after printing why to errors) if the input couldn't be opened or read.
+bool read_source(const char* path, source_t* source, FILE* errors);
+// Unmaps or frees the source text.
+void free_source(source_t* source);
+
+#endif
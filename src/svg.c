@@ -2,47 +2,156 @@
 #include <string.h>
 #include <math.h>
 
+#define SVG_STREAM_BUFFER_SIZE (64 * 1024)
+
+// Helper to write text to the stream, through the compressor if there is one.
+static void writesvg(svg_t* svg, const char* text, size_t length) {
+  if (svg->compressor != NULL) {
+    deflate_write(svg->compressor, text, length);
+  } else {
+    fwrite(text, 1, length, svg->out);
+  }
+}
+
+// Writes out and empties the buffered svg text.
+void svg_flush(svg_t* svg) {
+  if (svg->length == 0) {
+    return;
+  }
+
+  writesvg(svg, svg->svg, svg->length);
+  svg->length = 0;
+  svg->svg[0] = '\0';
+}
+
+// Helper to get room for `length` more bytes at the end of the svg text.
+// Returns NULL if it is too big to ever fit in the buffer.
+static char* spaceinsvg(svg_t* svg, size_t length) {
+  if (svg->length + length + 1 > svg->capacity) {
+    // The buffer never grows, flush it instead.
+    svg_flush(svg);
+    if (length + 1 > svg->capacity) {
+      return NULL;
+    }
+  }
+
+  return svg->svg + svg->length;
+}
+
+// Helper to mark `length` bytes written at the end of the svg text as used.
+static void commitsvg(svg_t* svg, size_t length) {
+  svg->length += length;
+  svg->svg[svg->length] = '\0';
+}
+
+// Helper to append `length` bytes of text to svg text.
+static void appendtosvg(svg_t* svg, const char* text, size_t length) {
+  char* p = spaceinsvg(svg, length);
+  if (p == NULL) {
+    // Too big to ever fit in the buffer, write it straight through.
+    writesvg(svg, text, length);
+    return;
+  }
+
+  memcpy(p, text, length);
+  commitsvg(svg, length);
+}
+
+// Helper to append string literal to svg text. (length known at compile time)
+#define appendliteraltosvg(svg, literal) appendtosvg((svg), (literal), sizeof(literal) - 1)
+
 // Helper to append string to svg text.
-static void appendstringtosvg(svg_t* svg, char* text) {
-  int l = strlen(svg->svg) + strlen(text) + 1;
+static void appendstringtosvg(svg_t* svg, const char* text) {
+  appendtosvg(svg, text, strlen(text));
+}
+
+// "00".."99" so integers can be written two digits at a time.
+static const char DIGIT_PAIRS[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
 
-  char* p = realloc(svg->svg, l);
+// Helper to count decimal digits of n.
+static int countdigits(unsigned long long n) {
+  int digits = 1;
+  while (n >= 10000) {
+    n /= 10000;
+    digits += 4;
+  }
+  if (n >= 1000) return digits + 3;
+  if (n >= 100) return digits + 2;
+  if (n >= 10) return digits + 1;
+  return digits;
+}
 
-  if (p) {
-    svg->svg = p;
+// Helper to write the digits of n ending just before end, two at a time.
+static void writedigits(char* end, unsigned long long n) {
+  while (n >= 100) {
+    unsigned long long q = n / 100;
+    end -= 2;
+    memcpy(end, &DIGIT_PAIRS[(n - q * 100) * 2], 2);
+    n = q;
+  }
+  if (n >= 10) {
+    memcpy(end - 2, &DIGIT_PAIRS[n * 2], 2);
+  } else {
+    end[-1] = (char)('0' + n);
   }
+}
+
+// Formats integer into out (needs SVG_NUMBER_MAX bytes). Returns length written (no terminator).
+int svg_format_int(char* out, int n) {
+  unsigned long long u = n < 0 ? 0ULL - (unsigned long long)(long long)n : (unsigned long long)n;
+  int sign = n < 0;
+  int length = sign + countdigits(u);
 
-  strcat(svg->svg, text);
+  out[0] = '-';
+  writedigits(out + length, u);
+  return length;
 }
 
 // Helper to append number to svg text.
 static void appendnumbertosvg(svg_t* svg, int n) {
-  char sn[16];
-
-  sprintf(sn, "%d", n);
+  char* p = spaceinsvg(svg, SVG_NUMBER_MAX);
+  if (p == NULL) {
+    return;
+  }
 
-  appendstringtosvg(svg, sn);
+  commitsvg(svg, svg_format_int(p, n));
 }
 
-// Creates, initializes, and returns svg.
-svg_t* svg_create(int width, int height) {
+// Helper to allocate svg with its buffer and write the opening svg tag.
+static svg_t* svg_init(int width, int height, FILE* out, deflate_t* compressor) {
   svg_t* svg = malloc(sizeof(svg_t));
 
   if (svg != NULL) {
-    svg->svg = NULL;
+    svg->svg = malloc(SVG_STREAM_BUFFER_SIZE);
+    svg->length = 0;
+    svg->capacity = SVG_STREAM_BUFFER_SIZE;
+    svg->out = out;
+    svg->compressor = compressor;
     svg->finalized = false;
     svg->width = width;
     svg->height = height;
 
-    svg->svg = malloc(1);
-
-    sprintf(svg->svg, "%s", "\0");
+    if (svg->svg == NULL) {
+      free(svg);
+      return NULL;
+    }
+    svg->svg[0] = '\0';
 
-    appendstringtosvg(svg, "<svg width='");
+    appendliteraltosvg(svg, "<svg width='");
     appendnumbertosvg(svg, width);
-    appendstringtosvg(svg, "px' height='");
+    appendliteraltosvg(svg, "px' height='");
     appendnumbertosvg(svg, height);
-    appendstringtosvg(svg, "px' xmlns='http://www.w3.org/2000/svg' version='1.1' xmlns:xlink='http://www.w3.org/1999/xlink'>\n");
+    appendliteraltosvg(svg, "px' xmlns='http://www.w3.org/2000/svg' version='1.1' xmlns:xlink='http://www.w3.org/1999/xlink'>\n");
 
     return svg;
   } else {
@@ -50,35 +159,50 @@ svg_t* svg_create(int width, int height) {
   }
 }
 
+// Creates, initializes, and returns svg that streams its text to out.
+svg_t* svg_create_stream(int width, int height, FILE* out) {
+  return svg_init(width, height, out, NULL);
+}
+
+// Creates, initializes, and returns svg that streams its text gzip compressed to out. (.svgz)
+svg_t* svg_create_compressed_stream(int width, int height, FILE* out, int level) {
+  deflate_t* compressor = deflate_create_file(DEFLATE_GZIP, level, out);
+  if (compressor == NULL) {
+    return NULL;
+  }
+
+  svg_t* svg = svg_init(width, height, out, compressor);
+  if (svg == NULL) {
+    deflate_free(compressor);
+  }
+  return svg;
+}
+
 // Ends svg tag and updates finalized state.
 void svg_finalize(svg_t* svg) {
-  appendstringtosvg(svg, "</svg>");
+  appendliteraltosvg(svg, "</svg>");
 
   svg->finalized = true;
 }
 
-// Prints the svg text.
-void svg_print(svg_t* svg) {
-  printf("%s\n", svg->svg);
-}
-
-// Saves svg file.
-void svg_save(svg_t* svg, char* file_path) {
+// Finalizes svg and flushes it to the stream.
+void svg_save(svg_t* svg) {
   if (!svg->finalized) {
     svg_finalize(svg);
   }
 
-  FILE* fp;
-
-  fp = fopen(file_path, "w");
-  if (fp != NULL) {
-    fwrite(svg->svg, 1, strlen(svg->svg), fp);
-    fclose(fp);
+  svg_flush(svg);
+  if (svg->compressor != NULL) {
+    deflate_finish(svg->compressor);
   }
+  fflush(svg->out);
 }
 
-// Frees svg memory.
+// Frees svg memory. (doesn't close a stream)
 void svg_free(svg_t* svg) {
+  if (svg->compressor != NULL) {
+    deflate_free(svg->compressor);
+  }
   free(svg->svg);
   free(svg);
 }
@@ -87,25 +211,25 @@ void svg_free(svg_t* svg) {
 void svg_rectangle(svg_t* svg, int width, int height,
                    int x, int y, char* fill, char* stroke,
                    int stroke_width, int radius_x, int radius_y) {
-  appendstringtosvg(svg, "  <rect fill='");
+  appendliteraltosvg(svg, "  <rect fill='");
   appendstringtosvg(svg, fill);
-  appendstringtosvg(svg, "' stroke='");
+  appendliteraltosvg(svg, "' stroke='");
   appendstringtosvg(svg, stroke);
-  appendstringtosvg(svg, "' stroke-width='");
+  appendliteraltosvg(svg, "' stroke-width='");
   appendnumbertosvg(svg, stroke_width);
-  appendstringtosvg(svg, "px' width='");
+  appendliteraltosvg(svg, "px' width='");
   appendnumbertosvg(svg, width);
-  appendstringtosvg(svg, "' height='");
+  appendliteraltosvg(svg, "' height='");
   appendnumbertosvg(svg, height);
-  appendstringtosvg(svg, "' y='");
+  appendliteraltosvg(svg, "' y='");
   appendnumbertosvg(svg, y);
-  appendstringtosvg(svg, "' x='");
+  appendliteraltosvg(svg, "' x='");
   appendnumbertosvg(svg, x);
-  appendstringtosvg(svg, "' ry='");
+  appendliteraltosvg(svg, "' ry='");
   appendnumbertosvg(svg, radius_y);
-  appendstringtosvg(svg, "' rx='");
+  appendliteraltosvg(svg, "' rx='");
   appendnumbertosvg(svg, radius_x);
-  appendstringtosvg(svg, "'/>\n");
+  appendliteraltosvg(svg, "'/>\n");
 }
 
 // Fills background of svg.
@@ -116,27 +240,27 @@ void svg_fill(svg_t* svg, char* fill) {
 // Adds line element to svg.
 void svg_line(svg_t* svg, char* stroke, int stroke_width,
               int x1, int y1, int x2, int y2) {
-  appendstringtosvg(svg, "  <line stroke='");
+  appendliteraltosvg(svg, "  <line stroke='");
   appendstringtosvg(svg, stroke);
-  appendstringtosvg(svg, "' stroke-width='");
+  appendliteraltosvg(svg, "' stroke-width='");
   appendnumbertosvg(svg, stroke_width);
-  appendstringtosvg(svg, "px' y2='");
+  appendliteraltosvg(svg, "px' y2='");
   appendnumbertosvg(svg, y2);
-  appendstringtosvg(svg, "' x2='");
+  appendliteraltosvg(svg, "' x2='");
   appendnumbertosvg(svg, x2);
-  appendstringtosvg(svg, "' y1='");
+  appendliteraltosvg(svg, "' y1='");
   appendnumbertosvg(svg, y1);
-  appendstringtosvg(svg, "' x1='");
+  appendliteraltosvg(svg, "' x1='");
   appendnumbertosvg(svg, x1);
-  appendstringtosvg(svg, "'/>\n");
+  appendliteraltosvg(svg, "'/>\n");
 }
 
-// Adds arrow element to svg.
-void svg_arrow(svg_t* svg, char* stroke, int stroke_width, int arrow_length,
-               int x1, int y1, int x2, int y2) {
-  // Draw the main line
-  svg_line(svg, stroke, stroke_width, x1, y1, x2, y2);
+// Arrowhead sides are 30 degrees off the line, so their rotation is constant.
+#define ARROW_COS 0.86602540378443864676 // cos(30 degrees)
+#define ARROW_SIN 0.5                    // sin(30 degrees)
 
+// Calculates the two end points of an arrowhead at (x2, y2).
+void svg_arrowhead_points(int arrow_length, int x1, int y1, int x2, int y2, int points[4]) {
   // Calculate the direction vector of the line
   double dx = x2 - x1;
   double dy = y2 - y1;
@@ -144,73 +268,178 @@ void svg_arrow(svg_t* svg, char* stroke, int stroke_width, int arrow_length,
   double unit_dx = dx / length;
   double unit_dy = dy / length;
 
-  // Arrowhead parameters
-  double arrow_angle = M_PI / 6; // 30 degrees in radians
+  // Calculate the points of the arrowhead (line direction rotated by +/- 30 degrees)
+  double along_x = arrow_length * unit_dx * ARROW_COS;
+  double along_y = arrow_length * unit_dy * ARROW_COS;
+  double across_x = arrow_length * unit_dy * ARROW_SIN;
+  double across_y = arrow_length * unit_dx * ARROW_SIN;
+  points[0] = x2 - (along_x - across_x);
+  points[1] = y2 - (along_y + across_y);
+  points[2] = x2 - (along_x + across_x);
+  points[3] = y2 - (along_y - across_y);
+}
+
+// Adds arrow element to svg.
+void svg_arrow(svg_t* svg, char* stroke, int stroke_width, int arrow_length,
+               int x1, int y1, int x2, int y2) {
+  // Draw the main line
+  svg_line(svg, stroke, stroke_width, x1, y1, x2, y2);
 
-  // Calculate the points of the arrowhead
-  int arrow_x1 = x2 - arrow_length * (unit_dx * cos(arrow_angle) - unit_dy * sin(arrow_angle));
-  int arrow_y1 = y2 - arrow_length * (unit_dy * cos(arrow_angle) + unit_dx * sin(arrow_angle));
-  int arrow_x2 = x2 - arrow_length * (unit_dx * cos(-arrow_angle) - unit_dy * sin(-arrow_angle));
-  int arrow_y2 = y2 - arrow_length * (unit_dy * cos(-arrow_angle) + unit_dx * sin(-arrow_angle));
+  int points[4];
+  svg_arrowhead_points(arrow_length, x1, y1, x2, y2, points);
 
   // Draw the arrowhead lines
-  svg_line(svg, stroke, stroke_width, x2, y2, arrow_x1, arrow_y1);
-  svg_line(svg, stroke, stroke_width, x2, y2, arrow_x2, arrow_y2);
+  svg_line(svg, stroke, stroke_width, x2, y2, points[0], points[1]);
+  svg_line(svg, stroke, stroke_width, x2, y2, points[2], points[3]);
 }
 
 // Draws text.
 void svg_text(svg_t* svg, int x, int y, char* font_family,
-              int font_size, char* fill, char* stroke, char* text) {
-  appendstringtosvg(svg, "  <text x='");
+              int font_size, char* fill, char* stroke, const char* text) {
+  appendliteraltosvg(svg, "  <text x='");
   appendnumbertosvg(svg, x);
-  appendstringtosvg(svg, "' y='");
+  appendliteraltosvg(svg, "' y='");
   appendnumbertosvg(svg, y);
-  appendstringtosvg(svg, "' font-family='");
+  appendliteraltosvg(svg, "' font-family='");
   appendstringtosvg(svg, font_family);
-  appendstringtosvg(svg, "' stroke='");
+  appendliteraltosvg(svg, "' stroke='");
   appendstringtosvg(svg, stroke);
-  appendstringtosvg(svg, "' fill='");
+  appendliteraltosvg(svg, "' fill='");
   appendstringtosvg(svg, fill);
-  appendstringtosvg(svg, "' font-size='");
+  appendliteraltosvg(svg, "' font-size='");
   appendnumbertosvg(svg, font_size);
-  appendstringtosvg(svg, "px");
-  appendstringtosvg(svg, "' text-anchor='middle' dominant-baseline='middle'>");
+  appendliteraltosvg(svg, "px");
+  appendliteraltosvg(svg, "' text-anchor='middle' dominant-baseline='middle'>");
   appendstringtosvg(svg, text);
-  appendstringtosvg(svg, "</text>\n");
+  appendliteraltosvg(svg, "</text>\n");
 }
 
 // Adds circle element to svg.
 void svg_circle(svg_t* svg, char* stroke, int stroke_width, char* fill, int r, int cx, int cy) {
-  appendstringtosvg(svg, "  <circle stroke='");
+  appendliteraltosvg(svg, "  <circle stroke='");
   appendstringtosvg(svg, stroke);
-  appendstringtosvg(svg, "' stroke-width='");
+  appendliteraltosvg(svg, "' stroke-width='");
   appendnumbertosvg(svg, stroke_width);
-  appendstringtosvg(svg, "px' fill='");
+  appendliteraltosvg(svg, "px' fill='");
   appendstringtosvg(svg, fill);
-  appendstringtosvg(svg, "' r='");
+  appendliteraltosvg(svg, "' r='");
   appendnumbertosvg(svg, r);
-  appendstringtosvg(svg, "' cy='");
+  appendliteraltosvg(svg, "' cy='");
   appendnumbertosvg(svg, cy);
-  appendstringtosvg(svg, "' cx='");
+  appendliteraltosvg(svg, "' cx='");
   appendnumbertosvg(svg, cx);
-  appendstringtosvg(svg, "'/>\n");
+  appendliteraltosvg(svg, "'/>\n");
 }
 
 // Adds ellipse element to svg.
 void svg_ellipse(svg_t* svg, int cx, int cy, int rx, int ry, char* fill, char* stroke, int stroke_width) {
-  appendstringtosvg(svg, "  <ellipse cx='");
+  appendliteraltosvg(svg, "  <ellipse cx='");
   appendnumbertosvg(svg, cx);
-  appendstringtosvg(svg, "' cy='");
+  appendliteraltosvg(svg, "' cy='");
   appendnumbertosvg(svg, cy);
-  appendstringtosvg(svg, "' rx='");
+  appendliteraltosvg(svg, "' rx='");
   appendnumbertosvg(svg, rx);
-  appendstringtosvg(svg, "' ry='");
+  appendliteraltosvg(svg, "' ry='");
   appendnumbertosvg(svg, ry);
-  appendstringtosvg(svg, "' fill='");
+  appendliteraltosvg(svg, "' fill='");
   appendstringtosvg(svg, fill);
-  appendstringtosvg(svg, "' stroke='");
+  appendliteraltosvg(svg, "' stroke='");
   appendstringtosvg(svg, stroke);
-  appendstringtosvg(svg, "' stroke-width='");
+  appendliteraltosvg(svg, "' stroke-width='");
   appendnumbertosvg(svg, stroke_width);
-  appendstringtosvg(svg, "'/>\n");
+  appendliteraltosvg(svg, "'/>\n");
+}
+
+// Adds style element with css text to svg.
+void svg_style(svg_t* svg, char* css) {
+  appendliteraltosvg(svg, "  <style>\n");
+  appendstringtosvg(svg, css);
+  appendliteraltosvg(svg, "  </style>\n");
+}
+
+// Adds rectangle element styled by class to svg.
+void svg_rectangle_class(svg_t* svg, char* class_name, int width, int height,
+                         int x, int y, int radius_x, int radius_y) {
+  appendliteraltosvg(svg, "  <rect class='");
+  appendstringtosvg(svg, class_name);
+  appendliteraltosvg(svg, "' x='");
+  appendnumbertosvg(svg, x);
+  appendliteraltosvg(svg, "' y='");
+  appendnumbertosvg(svg, y);
+  appendliteraltosvg(svg, "' width='");
+  appendnumbertosvg(svg, width);
+  appendliteraltosvg(svg, "' height='");
+  appendnumbertosvg(svg, height);
+  appendliteraltosvg(svg, "' rx='");
+  appendnumbertosvg(svg, radius_x);
+  appendliteraltosvg(svg, "' ry='");
+  appendnumbertosvg(svg, radius_y);
+  appendliteraltosvg(svg, "'/>\n");
+}
+
+// Draws text styled by class.
+void svg_text_class(svg_t* svg, char* class_name, int x, int y, const char* text) {
+  appendliteraltosvg(svg, "  <text class='");
+  appendstringtosvg(svg, class_name);
+  appendliteraltosvg(svg, "' x='");
+  appendnumbertosvg(svg, x);
+  appendliteraltosvg(svg, "' y='");
+  appendnumbertosvg(svg, y);
+  appendliteraltosvg(svg, "'>");
+  appendstringtosvg(svg, text);
+  appendliteraltosvg(svg, "</text>\n");
+}
+
+// Starts path element styled by class, segments are added until svg_path_end.
+void svg_path_begin(svg_t* svg, char* class_name) {
+  appendliteraltosvg(svg, "  <path class='");
+  appendstringtosvg(svg, class_name);
+  appendliteraltosvg(svg, "' d='");
+}
+
+// Helper to append path command with a point.
+static void appendpointtosvg(svg_t* svg, char command, int x, int y) {
+  char* p = spaceinsvg(svg, 2 * SVG_NUMBER_MAX + 2);
+  if (p == NULL) {
+    return;
+  }
+
+  int length = 0;
+  p[length++] = command;
+  length += svg_format_int(p + length, x);
+  p[length++] = ' ';
+  length += svg_format_int(p + length, y);
+  commitsvg(svg, length);
+}
+
+// Adds line segment to current path.
+void svg_path_line(svg_t* svg, int x1, int y1, int x2, int y2) {
+  appendpointtosvg(svg, 'M', x1, y1);
+  appendpointtosvg(svg, 'L', x2, y2);
+}
+
+// Continues current path with a line segment to (x, y).
+void svg_path_line_to(svg_t* svg, int x, int y) {
+  appendpointtosvg(svg, 'L', x, y);
+}
+
+// Adds arrowhead at (x2, y2) of a line from (x1, y1) to current path.
+void svg_path_arrowhead(svg_t* svg, int arrow_length, int x1, int y1, int x2, int y2) {
+  int points[4];
+  svg_arrowhead_points(arrow_length, x1, y1, x2, y2, points);
+
+  appendpointtosvg(svg, 'M', points[0], points[1]);
+  appendpointtosvg(svg, 'L', x2, y2);
+  appendpointtosvg(svg, 'L', points[2], points[3]);
+}
+
+// Adds arrow (line segment and arrowhead) to current path.
+void svg_path_arrow(svg_t* svg, int arrow_length, int x1, int y1, int x2, int y2) {
+  svg_path_line(svg, x1, y1, x2, y2);
+  svg_path_arrowhead(svg, arrow_length, x1, y1, x2, y2);
+}
+
+// Ends current path element.
+void svg_path_end(svg_t* svg) {
+  appendliteraltosvg(svg, "'/>\n");
 }
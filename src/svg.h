@@ -2,29 +2,45 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <math.h>
+#include "deflate.h"
+
+// Max bytes svg_format_int writes.
+#define SVG_NUMBER_MAX 32
 
 // svg struct
 typedef struct {
   char* svg;
+  size_t length;   // Bytes of svg text (excluding terminator).
+  size_t capacity; // Allocated bytes of svg text buffer. (fixed, it is flushed when full)
+  FILE* out;       // Stream the text is flushed to.
+  deflate_t* compressor; // Compresses text on its way to out, NULL if not compressing.
   int height;
   int width;
   bool finalized;
 } svg_t;
 
-// Creates, initializes, and returns svg.
-svg_t* svg_create(int width, int height);
+// Creates, initializes, and returns svg that is flushed to out as it is built.
+// (fixed size buffer so memory use doesn't depend on the size of the svg)
+svg_t* svg_create_stream(int width, int height, FILE* out);
+// Creates, initializes, and returns svg that is gzip compressed (.svgz) while streaming to out.
+// Level goes from 0 (store only) to 9 (smallest).
+svg_t* svg_create_compressed_stream(int width, int height, FILE* out, int level);
+// Writes buffered svg text out to stream.
+void svg_flush(svg_t* svg);
+// Formats integer into out. Returns length written. (no terminator)
+int svg_format_int(char* out, int n);
 // Ends svg tag and updates finalized state.
 void svg_finalize(svg_t* svg);
-// Prints the svg text.
-void svg_print(svg_t* svg);
-// Saves svg file.
-void svg_save(svg_t* svg, char* file_path);
+// Finalizes svg and flushes it to its stream.
+void svg_save(svg_t* svg);
 // Frees svg memory.
 void svg_free(svg_t* svg);
 // Adds circle element to svg.
 void svg_circle(svg_t* svg, char* stroke, int stroke_width, char* fill, int r, int cx, int cy);
 // Adds line element to svg.
 void svg_line(svg_t* svg, char* stroke, int stroke_width, int x1, int y1, int x2, int y2);
+// Calculates the two end points (x, y, x, y) of an arrowhead at (x2, y2) for a line from (x1, y1).
+void svg_arrowhead_points(int arrow_length, int x1, int y1, int x2, int y2, int points[4]);
 // Adds arrow element to svg.
 void svg_arrow(svg_t* svg, char* stroke, int stroke_width, int arrow_length, int x1, int y1, int x2, int y2);
 // Adds rectangle element to svg.
@@ -32,6 +48,25 @@ void svg_rectangle(svg_t* svg, int width, int height, int x, int y, char* fill,
 // Fills background of svg.
 void svg_fill(svg_t* svg, char* fill);
 // Draws text.
-void svg_text(svg_t* svg, int x, int y, char* font_family, int font_size, char* fill, char* stroke, char* text);
+void svg_text(svg_t* svg, int x, int y, char* font_family, int font_size, char* fill, char* stroke, const char* text);
 // Adds ellipse element to svg.
 void svg_ellipse(svg_t* svg, int cx, int cy, int rx, int ry, char* fill, char* stroke, int stroke_width); 
+// Adds style element with css text to svg. (lets elements share attributes through classes)
+void svg_style(svg_t* svg, char* css);
+// Adds rectangle element styled by class to svg.
+void svg_rectangle_class(svg_t* svg, char* class_name, int width, int height, int x, int y, int radius_x, int radius_y);
+// Draws text styled by class.
+void svg_text_class(svg_t* svg, char* class_name, int x, int y, const char* text);
+// Starts path element styled by class. Many lines/arrows can be batched into it
+// with svg_path_line and svg_path_arrow before ending it with svg_path_end.
+void svg_path_begin(svg_t* svg, char* class_name);
+// Adds line segment to current path.
+void svg_path_line(svg_t* svg, int x1, int y1, int x2, int y2);
+// Continues current path with a line segment to (x, y).
+void svg_path_line_to(svg_t* svg, int x, int y);
+// Adds arrowhead at (x2, y2) of a line from (x1, y1) to current path.
+void svg_path_arrowhead(svg_t* svg, int arrow_length, int x1, int y1, int x2, int y2);
+// Adds arrow (line segment and arrowhead) to current path.
+void svg_path_arrow(svg_t* svg, int arrow_length, int x1, int y1, int x2, int y2);
+// Ends current path element.
+void svg_path_end(svg_t* svg);
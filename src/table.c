@@ -6,21 +6,76 @@
 #include <assert.h>
 #include <stdio.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define FNV_OFFSET 14695981039346656037UL
 #define FNV_PRIME 1099511628211UL
 
-#define INITIAL_CAPACITY 16
+// Slots per group, one SSE2 register of control bytes.
+#define GROUP_SIZE 16
+#define INITIAL_CAPACITY GROUP_SIZE
+
+// Control bytes of slots without an entry, full slots hold the low 7 bits of their hash (high bit clear).
+#define CONTROL_EMPTY 0x80
+#define CONTROL_DELETED 0xfe
 
-// Function to hash a key.
-static uint64_t hash_key(const char* key) {
+// Function to hash a key that isn't null terminated. (FNV-1a)
+static uint64_t hash_key_n(const char* key, size_t length) {
   uint64_t hash = FNV_OFFSET;
-  for (const char* p = key; *p; p++) {
-    hash ^= (uint64_t)(unsigned char)(*p);
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint64_t)(unsigned char)key[i];
     hash *= FNV_PRIME;
   }
   return hash;
 }
 
+// Helper to get a bit mask of the slots in group whose control byte is value.
+static unsigned match_byte(const uint8_t* group, uint8_t value) {
+#ifdef __SSE2__
+  __m128i control = _mm_loadu_si128((const __m128i*)group);
+  return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8((char)value)));
+#else
+  unsigned mask = 0;
+  for (int i = 0; i < GROUP_SIZE; i++) {
+    mask |= (unsigned)(group[i] == value) << i;
+  }
+  return mask;
+#endif
+}
+
+// Helper to get a bit mask of the slots in group that are empty or deleted. (high bit set)
+static unsigned match_free(const uint8_t* group) {
+#ifdef __SSE2__
+  return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+  unsigned mask = 0;
+  for (int i = 0; i < GROUP_SIZE; i++) {
+    mask |= (unsigned)(group[i] >> 7) << i;
+  }
+  return mask;
+#endif
+}
+
+// Most slots (entries and tombstones) a table of capacity can have in use, 7/8 so probes always reach an empty slot.
+static int max_load(int capacity) {
+  return capacity - capacity / 8;
+}
+
+// Helper to allocate empty control bytes and entries for capacity slots. Returns false if memory allocation failed.
+static bool allocate_slots(int capacity, uint8_t** control, entry_t** entries) {
+  *control = malloc(capacity);
+  *entries = malloc(sizeof(entry_t) * capacity);
+  if (*control == NULL || *entries == NULL) {
+    free(*control);
+    free(*entries);
+    return false;
+  }
+  memset(*control, CONTROL_EMPTY, capacity);
+  return true;
+}
+
 // Creates and initializes table.
 table_t* create_table(void) {
   table_t* table = malloc(sizeof(table_t));
@@ -28,127 +83,180 @@ table_t* create_table(void) {
     return NULL;
   }
   table->count = 0;
+  table->tombstones = 0;
   table->capacity = INITIAL_CAPACITY;
-
-  table->entries = calloc(table->capacity, sizeof(entry_t));
-  if (table->entries == NULL) {
+  if (!allocate_slots(table->capacity, &table->control, &table->entries)) {
     free(table);
     return NULL;
   }
   return table;
 }
 
-// Frees the memory used by the table and the table itself.
+// Frees the memory used by the table and the table itself. (keys belong to the caller)
 void free_table(table_t* table) {
-  for (int i = 0; i < table->capacity; i++) {
-    free((void*)table->entries[i].key);
-  }
-
+  free(table->control);
   free(table->entries);
   free(table);
 }
 
-// Returns value specified by key, NULL if there is no key.
-void* table_get(table_t* table, const char* key) {
-  uint64_t hash = hash_key(key);
-  size_t index = (size_t)(hash & (uint64_t)(table->capacity - 1));
-
-  while (table->entries[index].key != NULL) {
-    if (strcmp(key, table->entries[index].key) == 0) {
-      return table->entries[index].value;
+// Helper to find the slot of key, -1 if it isn't in the table.
+// Groups are probed 1, 2, 3... groups further each time (which visits every group), and a group
+// with an empty slot ends the search since the key would have gone there.
+static int find_slot(table_t* table, const char* key, size_t length, uint64_t hash) {
+  size_t group_mask = (size_t)(table->capacity / GROUP_SIZE - 1);
+  size_t group = (size_t)(hash >> 7) & group_mask;
+  uint8_t tag = hash & 0x7f;
+  for (size_t step = 1;; step++) {
+    const uint8_t* control = table->control + group * GROUP_SIZE;
+    unsigned matches = match_byte(control, tag);
+    while (matches != 0) {
+      int slot = (int)(group * GROUP_SIZE) + __builtin_ctz(matches);
+      entry_t* entry = &table->entries[slot];
+      if (entry->hash == hash && entry->length == length && memcmp(entry->key, key, length) == 0) {
+        return slot;
+      }
+      matches &= matches - 1;
     }
-    index++;
-    if (index >= table->capacity) {
-      index = 0;
+    if (match_byte(control, CONTROL_EMPTY) != 0) {
+      return -1;
     }
+    group = (group + step) & group_mask;
   }
-  return NULL;
 }
 
-// Sets entry inside of table.
-static const char* table_set_entry(entry_t* entries, int capacity,
-                                   const char* key, void* value, int* plength) {
-  // Hash the key.
-  uint64_t hash = hash_key(key);
-  // Find index.
-  size_t index = (size_t)(hash & (uint64_t)(capacity - 1));
-
-  while (entries[index].key != NULL) {
-    // Find next bucket.
-    if (strcmp(key, entries[index].key) == 0) {
-      entries[index].value = value;
-      return entries[index].key;
-    }
-    index++;
-    if (index >= capacity) {
-      index = 0;
+// Helper to find the first empty or deleted slot on hash's probe sequence.
+static int find_free_slot(const uint8_t* control, int capacity, uint64_t hash) {
+  size_t group_mask = (size_t)(capacity / GROUP_SIZE - 1);
+  size_t group = (size_t)(hash >> 7) & group_mask;
+  for (size_t step = 1;; step++) {
+    unsigned free_slots = match_free(control + group * GROUP_SIZE);
+    if (free_slots != 0) {
+      return (int)(group * GROUP_SIZE) + __builtin_ctz(free_slots);
     }
+    group = (group + step) & group_mask;
   }
-
-  if (plength != NULL) {
-    key = strdup(key);
-    if (key == NULL) {
-      return NULL;
-    }
-    (*plength)++;
-  }
-  entries[index].key = (char*)key;
-  entries[index].value = value;
-  return key;
 }
 
-// Helper to expand the table capacity and reallocate the memory.
-static bool table_expand(table_t* table) {
-  int new_capacity = table->capacity * 2;
-  if (new_capacity < table->capacity) {
+// Helper to move every entry into new_capacity slots using the cached hashes, dropping the tombstones.
+static bool table_rehash(table_t* table, int new_capacity) {
+  uint8_t* control;
+  entry_t* entries;
+  if (!allocate_slots(new_capacity, &control, &entries)) {
     return false;
   }
 
-  // Calloc to initialize new entries.
-  entry_t* new_entries = calloc(new_capacity, sizeof(entry_t));
-  if (new_entries == NULL) {
-    return false;
-  }
-
-  // Copy old entries over.
   for (int i = 0; i < table->capacity; i++) {
-    entry_t entry = table->entries[i];
-    if (entry.key != NULL) {
-      table_set_entry(new_entries, new_capacity, entry.key,
-                      entry.value, NULL);
+    if ((table->control[i] & CONTROL_EMPTY) == 0) {
+      entry_t* entry = &table->entries[i];
+      int slot = find_free_slot(control, new_capacity, entry->hash);
+      control[slot] = entry->hash & 0x7f;
+      entries[slot] = *entry;
     }
   }
 
-  // Free old entries and update to new entries.
+  free(table->control);
   free(table->entries);
-  table->entries = new_entries;
+  table->control = control;
+  table->entries = entries;
   table->capacity = new_capacity;
+  table->tombstones = 0;
   return true;
 }
 
-// Sets a key value pair in the table.
-const char* table_set(table_t* table, const char* key, void* value) {
+// Grows the table so count entries fit.
+bool table_reserve(table_t* table, int count) {
+  int capacity = table->capacity;
+  while (max_load(capacity) < count) {
+    if (capacity > INT32_MAX / 2) {
+      return false;
+    }
+    capacity *= 2;
+  }
+  return capacity == table->capacity || table_rehash(table, capacity);
+}
+
+// Returns value specified by the first length chars of key, NULL if there is no key.
+// (lets token slices be looked up without copying them)
+void* table_get_n(table_t* table, const char* key, size_t length) {
+  int slot = find_slot(table, key, length, hash_key_n(key, length));
+  return slot != -1 ? table->entries[slot].value : NULL;
+}
+
+// Returns value specified by key, NULL if there is no key.
+void* table_get(table_t* table, const char* key) {
+  return table_get_n(table, key, strlen(key));
+}
+
+// Sets the value of the first length chars of key. (key is stored as is, not copied)
+const char* table_set_n(table_t* table, const char* key, size_t length, void* value) {
   assert(value != NULL);
   if (value == NULL) {
     return NULL;
   }
 
-  // Expand table if needed.
-  if (table->count >= table->capacity / 2) {
-    if (!table_expand(table)) {
+  uint64_t hash = hash_key_n(key, length);
+  int slot = find_slot(table, key, length, hash);
+  if (slot != -1) {
+    table->entries[slot].value = value;
+    return table->entries[slot].key;
+  }
+
+  // Make room if needed: grow once entries take up half the load, otherwise clearing the tombstones is enough.
+  if (table->count + table->tombstones + 1 > max_load(table->capacity)) {
+    bool crowded = table->count + 1 > max_load(table->capacity) / 2;
+    if (crowded && table->capacity > INT32_MAX / 2) {
+      return NULL;
+    }
+    if (!table_rehash(table, crowded ? table->capacity * 2 : table->capacity)) {
       return NULL;
     }
   }
 
-  return table_set_entry(table->entries, table->capacity, key, value,
-                         &table->count);
+  slot = find_free_slot(table->control, table->capacity, hash);
+  if (table->control[slot] == CONTROL_DELETED) {
+    table->tombstones--;
+  }
+  table->control[slot] = hash & 0x7f;
+  table->entries[slot] = (entry_t){ .key = key, .length = length, .hash = hash, .value = value };
+  table->count++;
+  return key;
+}
+
+// Sets a key value pair in the table. (key is stored as is, not copied)
+const char* table_set(table_t* table, const char* key, void* value) {
+  return table_set_n(table, key, strlen(key), value);
+}
+
+// Removes the first length chars of key from the table.
+bool table_delete_n(table_t* table, const char* key, size_t length) {
+  int slot = find_slot(table, key, length, hash_key_n(key, length));
+  if (slot == -1) {
+    return false;
+  }
+
+  // Probes stop at a group with an empty slot anyway, so only slots in full groups have to stay marked.
+  const uint8_t* group = table->control + slot / GROUP_SIZE * GROUP_SIZE;
+  if (match_byte(group, CONTROL_EMPTY) != 0) {
+    table->control[slot] = CONTROL_EMPTY;
+  } else {
+    table->control[slot] = CONTROL_DELETED;
+    table->tombstones++;
+  }
+  table->count--;
+  return true;
+}
+
+// Removes key from the table.
+bool table_delete(table_t* table, const char* key) {
+  return table_delete_n(table, key, strlen(key));
 }
 
-// Prints the table's entries' keys and values.
+// Prints the table's entries' keys and values. (values as pointers, callers store all kinds in them)
 void print_table(table_t* table) {
   for (int i = 0; i < table->capacity; i++) {
-    if (table->entries[i].key != NULL) {
-      printf("Key: %s, Value: %s\n", table->entries[i].key, (char*)table->entries[i].value);
+    if ((table->control[i] & CONTROL_EMPTY) == 0) {
+      printf("Key: %.*s, Value: %p\n", (int)table->entries[i].length, table->entries[i].key,
+             table->entries[i].value);
     }
   }
 }
@@ -2,28 +2,45 @@
 #define TABLE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // Table entry struct
 typedef struct {
-  char* key;
+  const char* key; // Not copied, has to live as long as the table. (e.g. an interned string)
+  size_t length;   // Key length, keys don't need to be null terminated.
+  uint64_t hash;   // Cached, so growing never hashes keys again.
   void* value;
 } entry_t;
 
-// Hashtable struct
+// Hashtable struct (Swiss table: slots come in groups of 16 whose control bytes are checked at once)
 typedef struct {
-  int count;
-  int capacity;
+  int count;         // Live entries.
+  int tombstones;    // Deleted slots still marked, they keep probe sequences going until the next rehash.
+  int capacity;      // Slots, a power of two and at least one group.
+  uint8_t* control;  // Per slot: empty, deleted, or the low 7 bits of the entry's hash.
   entry_t* entries;
 } table_t;
 
 // Creates, initializes, and returns table.
 table_t* create_table(void);
-// Frees memory used by table.
+// Frees memory used by table. (keys belong to the caller)
 void free_table(table_t* table);
+// Makes room for count entries in total, so inserting up to that many never grows the table.
+// Returns false if memory allocation failed.
+bool table_reserve(table_t* table, int count);
 // Returns value from key in table, NULL if no key found.
 void* table_get(table_t* table, const char* key);
-// Sets a key value pair in the table.
+// Returns value from the first length chars of key, NULL if no key found.
+void* table_get_n(table_t* table, const char* key, size_t length);
+// Sets a key value pair in the table, returns the stored key (NULL if memory allocation failed).
 const char* table_set(table_t* table, const char* key, void* value);
+// Sets the value of the first length chars of key, returns the stored key (NULL if memory allocation failed).
+const char* table_set_n(table_t* table, const char* key, size_t length, void* value);
+// Removes key from table, returns false if it wasn't there.
+bool table_delete(table_t* table, const char* key);
+// Removes the first length chars of key from table, returns false if it wasn't there.
+bool table_delete_n(table_t* table, const char* key, size_t length);
 // Prints the table.
 void print_table(table_t* table);
 